@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+
+
+// Number of heap allocations made by the current thread.
+// Counted only if the program is built with OTHELLO_COUNT_ALLOCATIONS (see othello.cpp), otherwise always 0.
+inline uint64_t& allocationCount() {
+    static thread_local uint64_t count = 0;
+    return count;
+}
+
+
+// Asserts that the current thread does not allocate memory during the lifetime of the object.
+// Does nothing unless OTHELLO_COUNT_ALLOCATIONS is defined.
+class NoAllocationScope {
+#ifdef OTHELLO_COUNT_ALLOCATIONS
+public:
+    NoAllocationScope() : start(allocationCount()) {}
+
+    ~NoAllocationScope() {
+        assert(allocationCount() == start && "memory allocated on the search path");
+    }
+
+private:
+    uint64_t start;
+#else
+public:
+    NoAllocationScope() {} // user-provided, so that an unused scope is not a warning
+#endif
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <new>
+
+#include "BlockingQueue.h"
+#include "GameRecord.h"
+#include "MyStrategy.h"
+
+
+// Searches every position of every game from a stream of game records.
+// Games are read lazily and distributed between worker threads, each of them owning its own MyStrategy.
+// For every position a line "<game> <ply> <best move> <score> <finished> <depth> <nodes>" is written,
+// where score is given from the point of view of the player to move.
+// If multiPV is not zero, every move is reported instead in a line
+// "<game> <ply> <move> <score> <exact|upper> <depth> <principal variation>", exact scores are found for multiPV best moves.
+// Lines of one game are written together, but games may come out of order.
+class BatchAnalyzer {
+public:
+    BatchAnalyzer(MyConstants _constants, size_t _threadCount, size_t _multiPV=0) : constants(_constants),
+        threadCount(_threadCount == 0 ? 1 : _threadCount), multiPV(_multiPV) {}
+
+    // Returns number of analyzed games. Games with illegal moves are reported to err and skipped.
+    size_t run(std::istream& in, std::ostream& out, std::ostream& err) {
+        BlockingQueue<Job> jobs(threadCount * 4);
+        std::mutex outputMutex;
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < threadCount; i++)
+            workers.emplace_back([this, &jobs, &outputMutex, &out, &err] {
+                std::unique_ptr<MyStrategy> strategy;
+                try {
+                    strategy.reset(new MyStrategy(constants));
+                } catch (const std::bad_alloc&) {
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    err << "can't allocate the transposition table, the thread analyzes nothing\n";
+                }
+                Job job;
+                while (jobs.pop(job)) {
+                    if (!strategy) // games are still taken, so that the reader is not blocked
+                        continue;
+                    std::string text;
+                    if (!analyze(*strategy, job, text)) {
+                        std::lock_guard<std::mutex> lock(outputMutex);
+                        err << "game " << job.index << ": illegal move\n";
+                        continue;
+                    }
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    out << text;
+                }
+            });
+
+        GameRecordReader reader(in);
+        Job job;
+        size_t count = 0;
+        int result;
+        while (reader.read(job.moves, result)) {
+            job.index = count++;
+            jobs.push(job);
+        }
+        jobs.close();
+
+        for (std::thread& worker : workers)
+            worker.join();
+
+        if (reader.isCorrupted())
+            err << "corrupted record after game " << count << '\n';
+        out.flush();
+        return count;
+    }
+
+private:
+    struct Job {
+        size_t index;
+        std::vector<Move> moves;
+    };
+
+    MyConstants constants;
+    size_t threadCount;
+    size_t multiPV;
+
+    bool analyze(MyStrategy& strategy, const Job& job, std::string& text) {
+        std::ostringstream stream;
+        Game game;
+        for (size_t ply = 0; ply <= job.moves.size(); ply++) {
+            if (game.isGameFinished())
+                break;
+
+            if (multiPV != 0) {
+                for (const MoveAnalysis& analysis : strategy.analyze(game, multiPV)) {
+                    stream << job.index << ' ' << ply << ' ' << moveToString(analysis.move) << ' ' << analysis.score <<
+                              (analysis.bound == MoveAnalysis::EXACT ? " exact " : " upper ") << analysis.depth;
+                    for (Move move : analysis.principalVariation)
+                        stream << ' ' << moveToString(move);
+                    stream << '\n';
+                }
+            } else {
+                SearchResult result = strategy.search(game);
+                stream << job.index << ' ' << ply << ' ' << moveToString(result.move) << ' ' <<
+                          result.score << ' ' << result.isFinished << ' ' <<
+                          strategy.getSearchInfo().depth << ' ' << strategy.getSearchInfo().nodes << '\n';
+            }
+
+            if (ply == job.moves.size())
+                break;
+            if (!game.isMovePossible(job.moves[ply], game.getCurrentColor()))
+                return false;
+            game.makeMove(job.moves[ply]);
+        }
+        text = stream.str();
+        return true;
+    }
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+
+#include "SearchControl.h"
+#include "SpscQueue.h"
+
+
+// One line of the protocol: a command followed by its arguments
+struct ProtocolMessage {
+    std::string command;
+    std::vector<std::string> arguments;
+};
+
+
+// Reads protocol lines in its own thread, so the engine can react to them while it searches.
+// "stop" and "time <milliseconds left>" are applied to the search control at once, the search polls it;
+// all other lines are queued for the strategy that waits for them.
+class AsyncInput {
+public:
+    // Search stops timeMargin seconds before the time received in a "time" message runs out
+    explicit AsyncInput(std::istream& in, double timeMargin=0.05) : state(std::make_shared<State>()) {
+        std::shared_ptr<State> sharedState = state;
+        reader = std::thread([sharedState, &in, timeMargin] { readLines(*sharedState, in, timeMargin); });
+    }
+
+    AsyncInput(const AsyncInput&) = delete;
+    AsyncInput& operator = (const AsyncInput&) = delete;
+
+    ~AsyncInput() {
+        // a blocking read can't be interrupted, the thread finishes at the end of input and owns its state
+        reader.detach();
+    }
+
+    // Waits for the next message. Returns false at the end of input.
+    bool read(ProtocolMessage& message) {
+        return state->messages.waitPop(message);
+    }
+
+    // Returns false if there is no message yet
+    bool tryRead(ProtocolMessage& message) {
+        return state->messages.tryPop(message);
+    }
+
+    SearchControl& getControl() {
+        return state->control;
+    }
+
+private:
+    struct State {
+        State() : messages(64) {}
+
+        SpscQueue<ProtocolMessage> messages;
+        SearchControl control;
+    };
+
+    std::shared_ptr<State> state;
+    std::thread reader;
+
+    static void readLines(State& state, std::istream& in, double timeMargin) {
+        std::string line;
+        while (std::getline(in, line)) {
+            ProtocolMessage message;
+            std::istringstream words(line);
+            if (!(words >> message.command))
+                continue;
+            std::string argument;
+            while (words >> argument)
+                message.arguments.push_back(argument);
+
+            if (message.command == "stop")
+                state.control.requestStop();
+            else if (message.command == "time" && !message.arguments.empty()) {
+                double timeLeft = std::atof(message.arguments[0].c_str()) / 1000.0 - timeMargin;
+                state.control.setDeadline(SearchControl::Clock::now() +
+                        std::chrono::duration_cast<SearchControl::Clock::duration>(std::chrono::duration<double>(timeLeft)));
+            } else
+                state.messages.push(std::move(message));
+        }
+        state.messages.close();
+    }
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+
+// Bounded multi-producer multi-consumer queue.
+// push blocks while the queue is full, pop blocks while it is empty and not closed.
+template <typename T>
+class BlockingQueue {
+public:
+    explicit BlockingQueue(size_t _capacity) : capacity(_capacity), closed(false) {}
+
+    void push(T value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return items.size() < capacity || closed; });
+        if (closed)
+            return;
+        items.push_back(std::move(value));
+        notEmpty.notify_one();
+    }
+
+    // Returns false when the queue is closed and there are no items left.
+    bool pop(T& value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+        if (items.empty())
+            return false;
+        value = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+private:
+    size_t capacity;
+    bool closed;
+    std::deque<T> items;
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+};
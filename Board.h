@@ -1,16 +1,29 @@
 #pragma once
 
-const size_t BOARD_X_DIM = 8;
-const size_t BOARD_Y_DIM = 8;
+#include <cstddef>
+#include <cstdint>
+
+// Board dimensions are fixed at compile time, e.g. -DOTHELLO_BOARD_X_DIM=10 -DOTHELLO_BOARD_Y_DIM=10
+#ifndef OTHELLO_BOARD_X_DIM
+#define OTHELLO_BOARD_X_DIM 8
+#endif
+#ifndef OTHELLO_BOARD_Y_DIM
+#define OTHELLO_BOARD_Y_DIM 8
+#endif
+
+const size_t BOARD_X_DIM = OTHELLO_BOARD_X_DIM;
+const size_t BOARD_Y_DIM = OTHELLO_BOARD_Y_DIM;
 
 enum Color { BLACK, WHITE, FREE };
 
 
-class Position {
+// Position on X x Y board. Positions outside of the board are replaced by (0, 0).
+template <size_t X, size_t Y>
+class BasicPosition {
 public:
-    Position(): _x(0), _y(0) {}
+    BasicPosition(): _x(0), _y(0) {}
 
-	Position(size_t x, size_t y) : _x(x), _y(y) {
+	BasicPosition(size_t x, size_t y) : _x(x), _y(y) {
 		if (!isCorrect())
 			_x = _y = 0;
 	}
@@ -34,11 +47,11 @@ public:
 		return true;
 	}
 
-	bool operator == (Position pos) const {
+	bool operator == (BasicPosition pos) const {
 		return _x == pos._x && _y == pos._y;
 	}
 
-	bool operator != (Position pos) const {
+	bool operator != (BasicPosition pos) const {
 		return _x != pos._x || _y != pos._y;
 	}
 
@@ -46,52 +59,304 @@ private:
 	size_t _x, _y;
 
 	bool isCorrect() const {
-		return _x < BOARD_X_DIM && _y < BOARD_Y_DIM;
+		return _x < X && _y < Y;
 	}
 };
 
+typedef BasicPosition<BOARD_X_DIM, BOARD_Y_DIM> Position;
+
+
+// Bitboard is an unsigned integer with one bit per board position.
+// Boards up to 64 positions (8x8, 6x6) use 64-bit words, boards up to 128 positions (10x10) use 128-bit words.
+template <size_t SIZE, bool FITS_64 = (SIZE <= 64)>
+struct BitboardTraits {
+    static_assert(SIZE <= 128, "boards with more than 128 positions are not supported");
+    typedef unsigned __int128 Type;
+};
+
+template <size_t SIZE>
+struct BitboardTraits<SIZE, true> {
+    typedef uint64_t Type;
+};
+
+inline int popCount(uint64_t bits) {
+    return __builtin_popcountll(bits);
+}
+
+inline int popCount(unsigned __int128 bits) {
+    return __builtin_popcountll(uint64_t(bits)) + __builtin_popcountll(uint64_t(bits >> 64));
+}
+
+inline size_t lowestBitIndex(uint64_t bits) {
+    return __builtin_ctzll(bits);
+}
+
+inline size_t lowestBitIndex(unsigned __int128 bits) {
+    return uint64_t(bits) != 0 ? __builtin_ctzll(uint64_t(bits)) : 64 + __builtin_ctzll(uint64_t(bits >> 64));
+}
+
+inline uint64_t highestBit(uint64_t bits) {
+    return uint64_t(1) << (63 - __builtin_clzll(bits));
+}
+
+inline unsigned __int128 highestBit(unsigned __int128 bits) {
+    uint64_t high = uint64_t(bits >> 64);
+    if (high != 0)
+        return (unsigned __int128)(highestBit(high)) << 64;
+    return highestBit(uint64_t(bits));
+}
+
+// splitmix64 finalizer
+inline uint64_t mixBits(uint64_t bits) {
+    bits = (bits ^ (bits >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    bits = (bits ^ (bits >> 27)) * 0x94D049BB133111EBULL;
+    return bits ^ (bits >> 31);
+}
+
+inline uint64_t mixBits(unsigned __int128 bits) {
+    return mixBits(uint64_t(bits) ^ mixBits(uint64_t(bits >> 64)));
+}
+
+
+// Masks and ray tables of X x Y board. Position (x, y) corresponds to bit x * Y + y.
+// Everything here is computed at compile time.
+template <size_t X, size_t Y>
+struct BoardGeometry {
+    static_assert(X >= 4 && Y >= 4 && X % 2 == 0 && Y % 2 == 0, "board dimensions must be even and at least 4");
+
+    typedef typename BitboardTraits<X * Y>::Type Bitboard;
+
+    static constexpr size_t SIZE = X * Y;
+    static constexpr size_t DIRECTIONS = 8;
+
+    static constexpr Bitboard bit(size_t x, size_t y) {
+        return Bitboard(1) << (x * Y + y);
+    }
+
+    static constexpr Bitboard all() {
+        return SIZE == 8 * sizeof(Bitboard) ? ~Bitboard(0) : (Bitboard(1) << SIZE) - 1;
+    }
+
+    static constexpr Bitboard column(size_t y) {
+        Bitboard result = 0;
+        for (size_t x = 0; x < X; x++)
+            result |= bit(x, y);
+        return result;
+    }
+
+    static constexpr Bitboard edges() {
+        Bitboard result = column(0) | column(Y - 1);
+        for (size_t y = 0; y < Y; y++)
+            result |= bit(0, y) | bit(X - 1, y);
+        return result;
+    }
+
+    // Corners are numbered 0 - (0, 0), 1 - (0, Y - 1), 2 - (X - 1, 0), 3 - (X - 1, Y - 1)
+    static constexpr size_t CORNERS = 4;
+
+    static constexpr Bitboard corner(size_t k) {
+        return bit(k < 2 ? 0 : X - 1, k % 2 == 0 ? 0 : Y - 1);
+    }
+
+    static constexpr Bitboard corners() {
+        return corner(0) | corner(1) | corner(2) | corner(3);
+    }
+
+    // X-field - position adjacent to a corner diagonally
+    static constexpr Bitboard xField(size_t k) {
+        return bit(k < 2 ? 1 : X - 2, k % 2 == 0 ? 1 : Y - 2);
+    }
+
+    // C-fields - positions adjacent to a corner vertically or horizontally
+    static constexpr Bitboard cFields(size_t k) {
+        return bit(k < 2 ? 0 : X - 1, k % 2 == 0 ? 1 : Y - 2) | bit(k < 2 ? 1 : X - 2, k % 2 == 0 ? 0 : Y - 1);
+    }
+
+    static constexpr Bitboard initialStones(bool isBlack) {
+        return isBlack ? bit(X / 2 - 1, Y / 2) | bit(X / 2, Y / 2 - 1) :
+                         bit(X / 2 - 1, Y / 2 - 1) | bit(X / 2, Y / 2);
+    }
+
+    static constexpr int dx(size_t direction) {
+        return direction < 3 ? -1 : (direction < 5 ? 0 : 1);
+    }
+
+    static constexpr int dy(size_t direction) {
+        return direction == 0 || direction == 3 || direction == 5 ? -1 :
+               (direction == 1 || direction == 6 ? 0 : 1);
+    }
+
+    // Directions in which index of position grows along the ray
+    static constexpr bool isIncreasing(size_t direction) {
+        return direction >= 4;
+    }
+
+    // rays[index][direction] - all positions from index (exclusive) to the edge of the board
+    struct Rays {
+        Bitboard rays[SIZE][DIRECTIONS];
+    };
+
+    static constexpr Rays makeRays() {
+        Rays result = {};
+        for (size_t x = 0; x < X; x++)
+            for (size_t y = 0; y < Y; y++)
+                for (size_t direction = 0; direction < DIRECTIONS; direction++) {
+                    Bitboard ray = 0;
+                    int rx = int(x) + dx(direction), ry = int(y) + dy(direction);
+                    for (; rx >= 0 && rx < int(X) && ry >= 0 && ry < int(Y); rx += dx(direction), ry += dy(direction))
+                        ray |= bit(rx, ry);
+                    result.rays[x * Y + y][direction] = ray;
+                }
+        return result;
+    }
+};
+
 
 // Simple representation of the state of the board. This class does not contain any game-related logic.
-class Board {
+// Board stores one bitboard per color and provides bitwise move generation.
+template <size_t X, size_t Y>
+class BasicBoard {
 public:
-	Board() {
-		for (size_t i = 0; i < X_DIM; i++)
-			for (size_t j = 0; j < Y_DIM; j++)
-				board[i][j] = FREE;
+    typedef BoardGeometry<X, Y> Geometry;
+    typedef typename Geometry::Bitboard Bitboard;
+    typedef BasicPosition<X, Y> Position;
+
+	static constexpr size_t X_DIM = X;
+	static constexpr size_t Y_DIM = Y;
+	static constexpr size_t SIZE = X * Y;
+
+	BasicBoard() {
+	    stones[BLACK] = stones[WHITE] = 0;
 	}
 
-	Color& operator [] (Position pos) {
-		return board[pos.x()][pos.y()];
+	static BasicBoard getInitial() {
+	    BasicBoard board;
+	    board.stones[BLACK] = Geometry::initialStones(true);
+	    board.stones[WHITE] = Geometry::initialStones(false);
+	    return board;
+	}
+
+	static size_t getIndex(Position pos) {
+	    return pos.x() * Y + pos.y();
+	}
+
+	static Bitboard getBit(Position pos) {
+	    return Bitboard(1) << getIndex(pos);
 	}
 
 	Color operator [] (Position pos) const {
-		return board[pos.x()][pos.y()];
+	    Bitboard bit = getBit(pos);
+	    if (stones[BLACK] & bit)
+	        return BLACK;
+	    if (stones[WHITE] & bit)
+	        return WHITE;
+	    return FREE;
+	}
+
+	void set(Position pos, Color color) {
+	    Bitboard bit = getBit(pos);
+	    stones[BLACK] &= ~bit;
+	    stones[WHITE] &= ~bit;
+	    if (color != FREE)
+	        stones[color] |= bit;
+	}
+
+	Bitboard getStones(Color color) const {
+	    return color == FREE ? getEmpty() : stones[color];
+	}
+
+	Bitboard getEmpty() const {
+	    return Geometry::all() & ~(stones[BLACK] | stones[WHITE]);
 	}
 
-    bool operator == (const Board& other) const {
-        for (size_t i = 0; i < Board::X_DIM; i++)
-            for (size_t j = 0; j < BOARD_Y_DIM; j++)
-                if (board[i][j] != other.board[i][j])
-                    return false;
-        return true;
+	int count(Color color) const {
+	    return popCount(getStones(color));
+	}
+
+	// Positions where player can place a stone
+	Bitboard getMoves(Color player) const {
+	    Bitboard own = stones[player], opponent = stones[1 - player];
+	    Bitboard moves = movesInDirection<-1, -1>(own, opponent) | movesInDirection<-1, 0>(own, opponent) |
+	                     movesInDirection<-1, 1>(own, opponent) | movesInDirection<0, -1>(own, opponent) |
+	                     movesInDirection<0, 1>(own, opponent) | movesInDirection<1, -1>(own, opponent) |
+	                     movesInDirection<1, 0>(own, opponent) | movesInDirection<1, 1>(own, opponent);
+	    return moves & getEmpty();
+	}
+
+	// Opponent's stones that are reversed if player places a stone at index
+	Bitboard getFlips(size_t index, Color player) const {
+	    Bitboard own = stones[player], opponent = stones[1 - player];
+	    Bitboard flips = 0;
+	    for (size_t direction = 0; direction < Geometry::DIRECTIONS; direction++) {
+	        Bitboard ray = RAYS.rays[index][direction];
+	        Bitboard blockers = ray & ~opponent;
+	        if (blockers == 0)
+	            continue;
+	        // the first non-opponent position along the ray must be player's stone
+	        Bitboard first = Geometry::isIncreasing(direction) ? blockers & (~blockers + 1) : highestBit(blockers);
+	        if (first & own)
+	            flips |= ray & (Geometry::isIncreasing(direction) ? first - 1 : ~(first | (first - 1)));
+	    }
+	    return flips;
+	}
+
+	// Stones adjacent to the given positions
+	static Bitboard getNeighbours(Bitboard positions) {
+	    return shift<-1, -1>(positions) | shift<-1, 0>(positions) | shift<-1, 1>(positions) | shift<0, -1>(positions) |
+	           shift<0, 1>(positions) | shift<1, -1>(positions) | shift<1, 0>(positions) | shift<1, 1>(positions);
+	}
+
+	void makeMove(size_t index, Bitboard flips, Color player) {
+	    stones[player] |= flips | (Bitboard(1) << index);
+	    stones[1 - player] &= ~flips;
+	}
+
+	void cancelMove(size_t index, Bitboard flips, Color player) {
+	    stones[player] &= ~(flips | (Bitboard(1) << index));
+	    stones[1 - player] |= flips;
+	}
+
+    bool operator == (const BasicBoard& other) const {
+        return stones[BLACK] == other.stones[BLACK] && stones[WHITE] == other.stones[WHITE];
     }
 
-	static const size_t X_DIM;
-	static const size_t Y_DIM;
+    uint64_t hash() const {
+        return mixBits(stones[BLACK]) ^ (mixBits(stones[WHITE]) * 0x9E3779B97F4A7C15ULL);
+    }
 
 private:
-	Color board[BOARD_X_DIM][BOARD_Y_DIM];
+	static constexpr typename Geometry::Rays RAYS = Geometry::makeRays();
+
+	Bitboard stones[2];
+
+	template <int DX, int DY>
+	static Bitboard shift(Bitboard bits) {
+	    const int amount = DX * int(Y) + DY;
+	    // moving along y must not wrap around to the neighbouring row
+	    const Bitboard mask = Geometry::all() & (DY == 1 ? ~Geometry::column(0) :
+	                                             DY == -1 ? ~Geometry::column(Y - 1) : ~Bitboard(0));
+	    return (amount > 0 ? bits << (amount > 0 ? amount : 0) : bits >> (amount < 0 ? -amount : 0)) & mask;
+	}
+
+	template <int DX, int DY>
+	static Bitboard movesInDirection(Bitboard own, Bitboard opponent) {
+	    Bitboard line = shift<DX, DY>(own) & opponent;
+	    for (size_t i = 2; i < (X > Y ? X : Y); i++)
+	        line |= shift<DX, DY>(line) & opponent;
+	    return shift<DX, DY>(line);
+	}
 };
-const size_t Board::X_DIM = BOARD_X_DIM;
-const size_t Board::Y_DIM = BOARD_Y_DIM;
+
+template <size_t X, size_t Y> constexpr size_t BasicBoard<X, Y>::X_DIM;
+template <size_t X, size_t Y> constexpr size_t BasicBoard<X, Y>::Y_DIM;
+template <size_t X, size_t Y> constexpr size_t BasicBoard<X, Y>::SIZE;
+template <size_t X, size_t Y> constexpr typename BasicBoard<X, Y>::Geometry::Rays BasicBoard<X, Y>::RAYS;
+
+typedef BasicBoard<BOARD_X_DIM, BOARD_Y_DIM> Board;
 
 
 struct BoardHasher {
     size_t operator () (const Board& board) const {
-        size_t hash = 0;
-        for (size_t i = 0; i < Board::X_DIM; i++)
-            for (size_t j = 0; j < Board::Y_DIM; j++)
-                hash = hash * 3 + board[Position(i, j)];
-        return hash;
+        return board.hash();
     }
 };
@@ -0,0 +1,295 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Game.h"
+
+
+// Persistent cache of exact endgame scores shared between runs and processes.
+// Positions are appended to a log file as fixed size records. Lookups go to the index file
+// (log path + ".index") - an open addressing hash table built from the log by buildIndex and
+// mapped read-only into memory, so any number of processes share one copy of it.
+// Records appended after the index was built are kept in memory until the index is rebuilt.
+class EndgameCache {
+public:
+    ~EndgameCache() {
+        if (index != MAP_FAILED)
+            munmap(index, indexSize);
+        if (logFile >= 0)
+            close(logFile);
+    }
+
+    // Opens the log (creating it unless isReadOnly) and its index if it exists.
+    // Returns nullptr if the files can't be opened or were written for another board.
+    static std::shared_ptr<EndgameCache> open(const std::string& path, bool isReadOnly) {
+        std::shared_ptr<EndgameCache> cache(new EndgameCache());
+        cache->logFile = ::open(path.c_str(), isReadOnly ? O_RDONLY : O_RDWR | O_CREAT | O_APPEND, 0644);
+        if (cache->logFile < 0)
+            return nullptr;
+
+        FileHeader header;
+        if (pread(cache->logFile, &header, sizeof(header), 0) == 0) {
+            if (isReadOnly)
+                return nullptr;
+            header = FileHeader::make(0, 0);
+            if (write(cache->logFile, &header, sizeof(header)) != ssize_t(sizeof(header)))
+                return nullptr;
+        } else if (!header.isCompatible())
+            return nullptr;
+
+        uint64_t indexedRecords = 0;
+        if (!cache->mapIndex(path + ".index", indexedRecords))
+            return nullptr;
+        if (!cache->readLog(indexedRecords))
+            return nullptr;
+        cache->isReadOnly = isReadOnly;
+        return cache;
+    }
+
+    bool lookup(const Game& game, int& score, Move& move) const {
+        Record key = makeRecord(game, 0, Move());
+        uint64_t hash = key.hash();
+        return lookupIndex(key, hash, score, move) || lookupTail(key, hash, score, move);
+    }
+
+    // Appends exact score of the position. Does nothing if the cache is read-only.
+    void store(const Game& game, int score, Move move) {
+        int cachedScore;
+        Move cachedMove;
+        if (isReadOnly || lookup(game, cachedScore, cachedMove))
+            return;
+        Record record = makeRecord(game, score, move);
+        std::lock_guard<std::shared_timed_mutex> lock(tailMutex);
+        if (!tail.emplace(record.hash(), record).second)
+            return;
+        tailSize.store(tail.size(), std::memory_order_release);
+        // O_APPEND makes every record land at the end of the file even if several processes write to it
+        if (write(logFile, &record, sizeof(record)) != ssize_t(sizeof(record)))
+            perror("endgame cache");
+    }
+
+    // Builds the index for all records of the log. The log is read sequentially and the index is filled
+    // in a mapped file, so the log does not have to fit in memory. The new index replaces the old one
+    // atomically, processes that have the old index mapped keep using it.
+    static bool buildIndex(const std::string& path, size_t& positions) {
+        FILE* log = fopen(path.c_str(), "rb");
+        if (!log)
+            return false;
+        FileHeader logHeader;
+        struct stat logStat;
+        bool isCorrect = fread(&logHeader, sizeof(logHeader), 1, log) == 1 && logHeader.isCompatible() &&
+                         fstat(fileno(log), &logStat) == 0;
+        uint64_t logRecords = isCorrect ? (logStat.st_size - sizeof(FileHeader)) / sizeof(Record) : 0;
+
+        // load factor is at most 1/2
+        uint64_t slotCount = 1;
+        while (slotCount < 2 * (logRecords + 1))
+            slotCount *= 2;
+        size_t indexSize = sizeof(FileHeader) + slotCount * sizeof(Record);
+        std::string temporaryPath = path + ".index.tmp";
+        int indexFile = isCorrect ? ::open(temporaryPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) : -1;
+        isCorrect = indexFile >= 0 && ftruncate(indexFile, indexSize) == 0;
+        void* mapping = isCorrect ? mmap(nullptr, indexSize, PROT_READ | PROT_WRITE, MAP_SHARED, indexFile, 0) :
+                                    MAP_FAILED;
+        isCorrect = mapping != MAP_FAILED;
+
+        positions = 0;
+        if (isCorrect) {
+            Record* slots = reinterpret_cast<Record*>(static_cast<char*>(mapping) + sizeof(FileHeader));
+            for (uint64_t slot = 0; slot < slotCount; slot++)
+                slots[slot].sideToMove = EMPTY_SLOT;
+
+            std::vector<Record> chunk(4096);
+            uint64_t readRecords = 0;
+            while (readRecords < logRecords) {
+                size_t count = fread(chunk.data(), sizeof(Record), size_t(std::min<uint64_t>(chunk.size(),
+                                     logRecords - readRecords)), log);
+                if (count == 0)
+                    break;
+                readRecords += count;
+                for (size_t i = 0; i < count; i++) {
+                    const Record& record = chunk[i];
+                    uint64_t slot = record.hash() & (slotCount - 1);
+                    while (slots[slot].sideToMove != EMPTY_SLOT && !slots[slot].isSamePosition(record))
+                        slot = (slot + 1) & (slotCount - 1);
+                    if (slots[slot].sideToMove == EMPTY_SLOT)
+                        positions++;
+                    slots[slot] = record;
+                }
+            }
+            FileHeader header = FileHeader::make(slotCount, logRecords);
+            memcpy(mapping, &header, sizeof(header));
+            isCorrect = readRecords == logRecords;
+        }
+
+        fclose(log);
+        if (mapping != MAP_FAILED)
+            munmap(mapping, indexSize);
+        if (indexFile >= 0)
+            isCorrect &= ::close(indexFile) == 0;
+        if (!isCorrect) {
+            if (indexFile >= 0)
+                std::remove(temporaryPath.c_str());
+            return false;
+        }
+        return rename(temporaryPath.c_str(), (path + ".index").c_str()) == 0;
+    }
+
+private:
+    static const uint8_t EMPTY_SLOT = 0xFF;
+    static const uint8_t PASS = 0xFF;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t boardXDim;
+        uint32_t boardYDim;
+        uint32_t recordSize;
+        uint64_t slotCount; // index only
+        uint64_t logRecords; // index only: number of log records in the index
+        char reserved[24];
+
+        static FileHeader make(uint64_t slotCount, uint64_t logRecords) {
+            FileHeader header;
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, "OTHELLOE", 8);
+            header.version = 1;
+            header.boardXDim = Board::X_DIM;
+            header.boardYDim = Board::Y_DIM;
+            header.recordSize = sizeof(Record);
+            header.slotCount = slotCount;
+            header.logRecords = logRecords;
+            return header;
+        }
+
+        bool isCompatible() const {
+            return memcmp(magic, "OTHELLOE", 8) == 0 && version == 1 && boardXDim == Board::X_DIM &&
+                   boardYDim == Board::Y_DIM && recordSize == sizeof(Record);
+        }
+    };
+
+    struct Record {
+        Board::Bitboard stones[2];
+        uint8_t sideToMove;
+        int8_t score;
+        uint8_t move;
+
+        uint64_t hash() const {
+            return mixBits(stones[BLACK]) ^ (mixBits(stones[WHITE]) * 0x9E3779B97F4A7C15ULL) ^ sideToMove;
+        }
+
+        bool isSamePosition(const Record& other) const {
+            return stones[BLACK] == other.stones[BLACK] && stones[WHITE] == other.stones[WHITE] &&
+                   sideToMove == other.sideToMove;
+        }
+
+        void get(int& _score, Move& _move) const {
+            _score = score;
+            if (move == PASS)
+                _move = Move();
+            else
+                _move = Move(Position(move / Board::Y_DIM, move % Board::Y_DIM), false);
+        }
+    };
+
+    int logFile = -1;
+    bool isReadOnly = true;
+    void* index = MAP_FAILED;
+    size_t indexSize = 0;
+    uint64_t slotCount = 0;
+    mutable std::shared_timed_mutex tailMutex; // lookups share it, so parallel searches don't wait for each other
+    std::unordered_map<uint64_t, Record> tail; // records that are not in the index
+    std::atomic<size_t> tailSize{0}; // lets lookups skip the lock while the tail is empty
+
+    EndgameCache() {}
+
+    static Record makeRecord(const Game& game, int score, Move move) {
+        Record record;
+        memset(&record, 0, sizeof(record));
+        record.stones[BLACK] = game.getBoard().getStones(BLACK);
+        record.stones[WHITE] = game.getBoard().getStones(WHITE);
+        record.sideToMove = uint8_t(game.getCurrentColor());
+        record.score = int8_t(score);
+        record.move = move.isPass ? PASS : uint8_t(Board::getIndex(move.pos));
+        return record;
+    }
+
+    bool mapIndex(const std::string& indexPath, uint64_t& indexedRecords) {
+        int file = ::open(indexPath.c_str(), O_RDONLY);
+        if (file < 0)
+            return true; // there is no index yet
+        struct stat indexStat;
+        FileHeader header;
+        bool isCorrect = fstat(file, &indexStat) == 0 && pread(file, &header, sizeof(header), 0) == ssize_t(sizeof(header)) &&
+                         header.isCompatible() && uint64_t(indexStat.st_size) == sizeof(header) + header.slotCount * sizeof(Record);
+        if (isCorrect) {
+            indexSize = indexStat.st_size;
+            index = mmap(nullptr, indexSize, PROT_READ, MAP_SHARED, file, 0);
+            isCorrect = index != MAP_FAILED;
+        }
+        ::close(file);
+        if (isCorrect) {
+            slotCount = header.slotCount;
+            indexedRecords = header.logRecords;
+        }
+        return isCorrect;
+    }
+
+    // The index is immutable while it is mapped, so it is read without locking
+    bool lookupIndex(const Record& key, uint64_t hash, int& score, Move& move) const {
+        if (slotCount == 0)
+            return false;
+        const char* slots = static_cast<const char*>(index) + sizeof(FileHeader);
+        for (uint64_t slot = hash & (slotCount - 1); ; slot = (slot + 1) & (slotCount - 1)) {
+            Record record;
+            memcpy(&record, slots + slot * sizeof(Record), sizeof(Record));
+            if (record.sideToMove == EMPTY_SLOT)
+                return false;
+            if (record.isSamePosition(key)) {
+                record.get(score, move);
+                return true;
+            }
+        }
+    }
+
+    bool lookupTail(const Record& key, uint64_t hash, int& score, Move& move) const {
+        if (tailSize.load(std::memory_order_acquire) == 0)
+            return false;
+        std::shared_lock<std::shared_timed_mutex> lock(tailMutex);
+        auto it = tail.find(hash);
+        if (it == tail.end() || !it->second.isSamePosition(key))
+            return false;
+        it->second.get(score, move);
+        return true;
+    }
+
+    // Reads the records written after the index was built into the tail
+    bool readLog(uint64_t firstRecord) {
+        std::vector<Record> chunk(4096);
+        off_t offset = sizeof(FileHeader) + firstRecord * sizeof(Record);
+        while (true) {
+            ssize_t size = pread(logFile, chunk.data(), chunk.size() * sizeof(Record), offset);
+            if (size == 0)
+                return true;
+            if (size < 0 || size % sizeof(Record) != 0)
+                return false;
+            for (size_t i = 0; i < size_t(size) / sizeof(Record); i++)
+                tail.emplace(chunk[i].hash(), chunk[i]);
+            tailSize = tail.size();
+            offset += size;
+        }
+    }
+};
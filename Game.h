@@ -23,11 +23,51 @@ public:
 };
 
 
-// struct that represents state change of a single board position.
-struct Change {
-	Position position;
-	Color oldValue;
-	Color newValue;
+// List of moves with fixed capacity, so generating moves does not allocate memory.
+class MoveList {
+public:
+    MoveList() : count(0) {}
+
+    void push_back(Move move) {
+        moves[count++] = move;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    Move& operator [] (size_t i) {
+        return moves[i];
+    }
+
+    Move operator [] (size_t i) const {
+        return moves[i];
+    }
+
+    Move* begin() {
+        return moves;
+    }
+
+    Move* end() {
+        return moves + count;
+    }
+
+    const Move* begin() const {
+        return moves;
+    }
+
+    const Move* end() const {
+        return moves + count;
+    }
+
+private:
+    // pass is possible only if there are no other moves, so one entry per board position is enough
+    Move moves[Board::SIZE];
+    size_t count;
 };
 
 
@@ -35,55 +75,44 @@ struct Change {
 // Implements game logic.
 class Game {
 public:
-	Game() {
-	    // Initial board position
-        if (Board::X_DIM == 8 && Board::Y_DIM == 8) {
-			board[Position(3, 3)] = WHITE;
-			board[Position(3, 4)] = BLACK;
-			board[Position(4, 3)] = BLACK;
-			board[Position(4, 4)] = WHITE;
-
-            // initially there are two black and two white stones and 60 free spots
-			score[WHITE] = score[BLACK] = 2;
-			score[FREE] = 60;
-		}
-    }
-
-	void makeMove(Move move) {
-		if (isMovePossible(move, getCurrentColor())) {
-			std::vector<Change> changesDuringMove;
+	Game() : board(Board::getInitial()) {}
 
-			if (move.isPass) {
-				moves.push_back(move);
-				changes.push_back(changesDuringMove);
-				return;
-			}
+	// Returns false and does nothing if the move is illegal
+	bool makeMove(Move move) {
+		if (!isMovePossible(move, getCurrentColor()))
+			return false;
+		if (move.isPass) {
+			moves.push_back(move);
+			flips.push_back(0);
+			return true;
+		}
 
-			// place a stone at move's position
-			changesDuringMove.push_back(makeChange(move.pos, getCurrentColor()));
+		// place a stone at move's position and reverse opponent stones
+		size_t index = Board::getIndex(move.pos);
+		Board::Bitboard reversed = board.getFlips(index, getCurrentColor());
+		board.makeMove(index, reversed, getCurrentColor());
 
-			// reverse opponent stones
-			for (int dx = -1; dx <= 1; dx++)
-				for (int dy = -1; dy <= 1; dy++) {
-					if (dx == 0 && dy == 0) continue;
-					Position pos = move.pos;
-					while (pos.add(dx, dy) && board[pos] == getOppositeColor(getCurrentColor()));
-					if (pos != move.pos && board[pos] == getCurrentColor())
-						while (pos.add(-dx, -dy) && pos != move.pos)
-							changesDuringMove.push_back(makeChange(pos, getCurrentColor()));
-				}
+		moves.push_back(move);
+		flips.push_back(reversed);
+		return true;
+	}
 
-			moves.push_back(move);
-			changes.push_back(changesDuringMove);
-		}
+	// Preallocates memory for the rest of the game, after that makeMove and cancelMove never allocate memory.
+	void reserveHistory() {
+	    // every move except pass takes one free position and there can't be more than two passes in a row
+	    size_t maxMoves = 2 * Board::SIZE + 2;
+	    moves.reserve(maxMoves);
+	    flips.reserve(maxMoves);
 	}
 
 	void cancelMove() {
 		if (getMoveNumber() > 0) {
-			for (const Change & change : changes.back())
-				cancelChange(change);
+			Move move = moves.back();
+			Board::Bitboard reversed = flips.back();
 			moves.pop_back();
-			changes.pop_back();
+			flips.pop_back();
+			if (!move.isPass)
+				board.cancelMove(Board::getIndex(move.pos), reversed, getCurrentColor());
 		}
 	}
 
@@ -116,34 +145,23 @@ public:
 		if (playerColor != WHITE && playerColor != BLACK)
 			return false;
 		if (move.isPass)
-			return true; // pass is always possible
+			return board.getMoves(playerColor) == 0; // pass is possible only if there are no other moves
 		if (board[move.pos] != FREE)
 			return false; // can't place a stone if position is already occupied
 
 		// move is possible only if at least one opponent's stone will be reversed
-		for (int dx = -1; dx <= 1; dx++)
-			for (int dy = -1; dy <= 1; dy++) {
-				if (dx == 0 && dy == 0)
-				    continue;
-				Position pos = move.pos;
-				if (pos.add(dx, dy) && board[pos] == getOppositeColor(playerColor)) {
-					while (pos.add(dx, dy) && board[pos] == getOppositeColor(playerColor));
-
-					if (pos != move.pos && board[pos] == playerColor)
-						return true;
-				}
-			}
-		return false;
+		return board.getFlips(Board::getIndex(move.pos), playerColor) != 0;
 	}
 
-	std::vector<Move> getPossibleMoves(Color playerColor) const {
-		std::vector<Move> possible_moves;
-		for (size_t i = 0; i < Board::X_DIM; i++)
-			for (size_t j = 0; j < Board::Y_DIM; j++)
-				if (isMovePossible(Move(Position(i, j), false), playerColor))
-                    possible_moves.emplace_back(Move(Position(i, j), false));
+	MoveList getPossibleMoves(Color playerColor) const {
+		MoveList possible_moves;
+		if (playerColor == WHITE || playerColor == BLACK)
+			for (Board::Bitboard positions = board.getMoves(playerColor); positions != 0; positions &= positions - 1) {
+				size_t index = lowestBitIndex(positions);
+				possible_moves.push_back(Move(Position(index / Board::Y_DIM, index % Board::Y_DIM), false));
+			}
 		if (possible_moves.empty())
-            possible_moves.emplace_back(Move(Position(), true));
+            possible_moves.push_back(Move(Position(), true));
 		return possible_moves;
 	}
 
@@ -154,11 +172,11 @@ public:
 
 	int getScore(Color color) const {
 	    // score for player is a number of stones of his color
-		return score[color];
+		return board.count(color);
 	}
 
     int getScoreDifference(Color color) const {
-        return score[color] - score[getOppositeColor(color)];
+        return getScore(color) - getScore(getOppositeColor(color));
     }
 
 	size_t getAmountOfFreePositions() const {
@@ -167,28 +185,6 @@ public:
 
 private:
 	std::vector<Move> moves;
-	std::vector< std::vector<Change> > changes;
+	std::vector<Board::Bitboard> flips; // stones reversed by every move
 	Board board;
-
-	int score[3];
-
-	Change makeChange(Position pos, Color newValue) {
-		Change change;
-		change.position = pos;
-		change.oldValue = board[pos];
-		change.newValue = newValue;
-		board[pos] = newValue;
-
-		score[change.newValue]++;
-		score[change.oldValue]--;
-
-		return change;
-	}
-
-	void cancelChange(Change change) {
-		board[change.position] = change.oldValue;
-
-		score[change.newValue]--;
-		score[change.oldValue]++;
-	}
 };
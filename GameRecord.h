@@ -0,0 +1,144 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cctype>
+#include <cstdint>
+
+#include "Game.h"
+
+
+// Text notation of a move: column letter followed by row number (e.g. "f5"), "pass" for a pass.
+inline std::string moveToString(Move move) {
+    if (move.isPass)
+        return "pass";
+    return std::string(1, char(move.pos.y() + 'a')) + std::to_string(move.pos.x() + 1);
+}
+
+// Parses a move in text notation starting at text[offset]. On success advances offset past the move.
+inline bool parseMove(const std::string& text, size_t& offset, Move& move) {
+    if (text.compare(offset, 4, "pass") == 0) {
+        move = Move();
+        offset += 4;
+        return true;
+    }
+    if (offset >= text.size() || text[offset] < 'a' || text[offset] >= char('a' + Board::Y_DIM))
+        return false;
+    size_t y = text[offset] - 'a';
+    size_t end = offset + 1;
+    size_t x = 0;
+    while (end < text.size() && isdigit(text[end]))
+        x = x * 10 + (text[end++] - '0');
+    if (end == offset + 1 || x < 1 || x > Board::X_DIM)
+        return false;
+    move = Move(Position(x - 1, y), false);
+    offset = end;
+    return true;
+}
+
+
+// Compact binary game record.
+// Every game starts with a 3 byte header: magic byte, number of moves and final score difference
+// (black minus white, or UNFINISHED if the game is not over). Then follows one byte per move:
+// x * Board::Y_DIM + y for a stone placement and PASS_CODE for a pass.
+// Records are self-delimiting, so any number of games can be concatenated into one stream.
+class GameRecord {
+public:
+    static const uint8_t MAGIC = 0xA5;
+    static const int8_t UNFINISHED = -128;
+    static const size_t MAX_MOVES = 255;
+
+    static uint8_t encode(Move move) {
+        if (move.isPass)
+            return PASS_CODE;
+        return uint8_t(move.pos.x() * Board::Y_DIM + move.pos.y());
+    }
+
+    static bool decode(uint8_t code, Move& move) {
+        if (code == PASS_CODE) {
+            move = Move();
+            return true;
+        }
+        if (code >= Board::SIZE)
+            return false;
+        move = Move(Position(code / Board::Y_DIM, code % Board::Y_DIM), false);
+        return true;
+    }
+
+    // Replays moves from the initial position. Returns false if some move is illegal.
+    static bool replay(const std::vector<Move>& moves, Game& game) {
+        for (Move move : moves) {
+            if (game.isGameFinished() || !game.isMovePossible(move, game.getCurrentColor()))
+                return false;
+            game.makeMove(move);
+        }
+        return true;
+    }
+
+private:
+    static const uint8_t PASS_CODE = uint8_t(Board::SIZE);
+};
+
+
+class GameRecordWriter {
+public:
+    explicit GameRecordWriter(std::ostream& _out) : out(_out) {}
+
+    void write(const Game& game) {
+        const std::vector<Move>& moves = game.getMoves();
+        size_t count = moves.size() < GameRecord::MAX_MOVES ? moves.size() : size_t(GameRecord::MAX_MOVES);
+
+        char buffer[3 + GameRecord::MAX_MOVES];
+        buffer[0] = char(GameRecord::MAGIC);
+        buffer[1] = char(count);
+        buffer[2] = char(game.isGameFinished() ? int8_t(game.getScoreDifference(BLACK)) : int8_t(GameRecord::UNFINISHED));
+        for (size_t i = 0; i < count; i++)
+            buffer[3 + i] = char(GameRecord::encode(moves[i]));
+        out.write(buffer, 3 + count);
+    }
+
+private:
+    std::ostream& out;
+};
+
+
+// Reads records one by one, so arbitrary large streams can be processed in constant memory.
+class GameRecordReader {
+public:
+    explicit GameRecordReader(std::istream& _in) : in(_in), corrupted(false) {}
+
+    // Returns false at the end of stream or if the stream is corrupted (see isCorrupted).
+    bool read(std::vector<Move>& moves, int& result) {
+        unsigned char header[3];
+        if (!in.read(reinterpret_cast<char*>(header), 3))
+            return false;
+        if (header[0] != GameRecord::MAGIC) {
+            corrupted = true;
+            return false;
+        }
+        result = int8_t(header[2]);
+
+        unsigned char codes[GameRecord::MAX_MOVES];
+        if (!in.read(reinterpret_cast<char*>(codes), header[1])) {
+            corrupted = true;
+            return false;
+        }
+
+        moves.resize(header[1]);
+        for (size_t i = 0; i < moves.size(); i++)
+            if (!GameRecord::decode(codes[i], moves[i])) {
+                corrupted = true;
+                return false;
+            }
+        return true;
+    }
+
+    bool isCorrupted() const {
+        return corrupted;
+    }
+
+private:
+    std::istream& in;
+    bool corrupted;
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+enum PageKind {
+    NORMAL_PAGES,
+    TRANSPARENT_HUGE_PAGES, // the system may use huge pages, but does not guarantee it
+    HUGE_PAGES
+};
+
+
+// Fixed size array for large tables that are probed at random, such as the transposition table.
+// Memory is mapped directly from the system. With largePages the array is placed in huge pages to reduce TLB misses:
+// explicit huge pages (MAP_HUGETLB) are used if the system has reserved enough of them, otherwise transparent huge
+// pages are requested with madvise, otherwise normal pages are used.
+// Elements are constructed by initThreads threads, each of them touching its own part of the array first. If there
+// are several threads and several NUMA nodes, pages are interleaved between the nodes, so that threads running on
+// different nodes have the same latency to the table and no node runs out of memory.
+template <typename T>
+class LargeArray {
+public:
+    static_assert(std::is_trivially_destructible<T>::value, "elements are never destroyed");
+
+    LargeArray(size_t _size, bool largePages=false, size_t initThreads=1) :
+        data(nullptr), mapping(nullptr), mappingSize(0), count(_size), pageKind(NORMAL_PAGES) {
+        size_t bytes = std::max<size_t>(count * sizeof(T), 1);
+        if (largePages) {
+            size_t hugePageSize = getHugePageSize();
+            mappingSize = roundUp(bytes, hugePageSize);
+            mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (mapping != MAP_FAILED)
+                pageKind = HUGE_PAGES;
+            else {
+                // transparent huge pages need an aligned range
+                mappingSize = roundUp(bytes, hugePageSize) + hugePageSize;
+                mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (mapping != MAP_FAILED && madvise(align(mapping, hugePageSize), mappingSize - hugePageSize,
+                                                     MADV_HUGEPAGE) == 0)
+                    pageKind = TRANSPARENT_HUGE_PAGES;
+            }
+            if (mapping != MAP_FAILED)
+                data = reinterpret_cast<T*>(align(mapping, hugePageSize));
+        }
+        if (!data) {
+            mappingSize = bytes;
+            mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mapping == MAP_FAILED)
+                throw std::bad_alloc();
+            data = reinterpret_cast<T*>(mapping);
+        }
+
+        if (initThreads > 1)
+            interleave(mapping, mappingSize);
+        construct(initThreads);
+    }
+
+    LargeArray(const LargeArray&) = delete;
+    LargeArray& operator = (const LargeArray&) = delete;
+
+    ~LargeArray() {
+        munmap(mapping, mappingSize);
+    }
+
+    T& operator [] (size_t index) {
+        return data[index];
+    }
+
+    const T& operator [] (size_t index) const {
+        return data[index];
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    PageKind getPageKind() const {
+        return pageKind;
+    }
+
+private:
+    static const size_t DEFAULT_HUGE_PAGE_SIZE = size_t(2) << 20;
+
+    T* data;
+    void* mapping;
+    size_t mappingSize;
+    size_t count;
+    PageKind pageKind;
+
+    static size_t roundUp(size_t value, size_t unit) {
+        return (value + unit - 1) / unit * unit;
+    }
+
+    static void* align(void* pointer, size_t alignment) {
+        return reinterpret_cast<void*>(roundUp(reinterpret_cast<uintptr_t>(pointer), alignment));
+    }
+
+    // Default size of explicit huge pages, the usual 2 MB if it is unknown
+    static size_t getHugePageSize() {
+        std::ifstream meminfo("/proc/meminfo");
+        std::string name;
+        size_t kilobytes;
+        while (meminfo >> name) {
+            if (name == "Hugepagesize:" && meminfo >> kilobytes && kilobytes != 0)
+                return kilobytes << 10;
+            meminfo.ignore(256, '\n');
+        }
+        return DEFAULT_HUGE_PAGE_SIZE;
+    }
+
+    // Sets the interleave policy for the range if there are several NUMA nodes, does nothing otherwise
+    static void interleave(void* address, size_t length) {
+#ifdef SYS_mbind
+        const int MPOL_INTERLEAVE = 3; // from numaif.h, which is not installed everywhere
+        std::vector<unsigned long> nodes;
+        std::ifstream online("/sys/devices/system/node/online");
+        size_t first, last, nodeCount = 0;
+        char separator = ',';
+        // the list looks like "0-1,3"
+        while (separator == ',' && online >> first) {
+            last = first;
+            if (online.peek() == '-')
+                online >> separator >> last;
+            for (size_t node = first; node <= last; node++, nodeCount++) {
+                size_t bits = 8 * sizeof(unsigned long);
+                nodes.resize(std::max(nodes.size(), node / bits + 1), 0);
+                nodes[node / bits] |= 1UL << (node % bits);
+            }
+            if (!(online >> separator))
+                break;
+        }
+        if (nodeCount > 1)
+            syscall(SYS_mbind, address, length, MPOL_INTERLEAVE, nodes.data(),
+                    nodes.size() * 8 * sizeof(unsigned long) + 1, 0);
+#else
+        (void)address;
+        (void)length;
+#endif
+    }
+
+    // Constructs elements in parallel, every thread touches the pages of its own part first
+    void construct(size_t threadCount) {
+        threadCount = std::max<size_t>(1, std::min(threadCount, count / 4096 + 1));
+        auto constructPart = [this, threadCount](size_t part) {
+            for (size_t i = count * part / threadCount; i < count * (part + 1) / threadCount; i++)
+                new (data + i) T();
+        };
+        std::vector<std::thread> threads;
+        for (size_t part = 1; part < threadCount; part++)
+            threads.emplace_back(constructPart, part);
+        constructPart(0);
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+};
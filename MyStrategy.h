@@ -1,19 +1,60 @@
 #pragma once
 
-#include <queue>
-#include <unordered_map>
 #include <memory>
-#include <ctime>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include "AllocationCounter.h"
+#include "EndgameCache.h"
+#include "LargeArray.h"
+#include "OpeningBook.h"
+#include "SearchControl.h"
+#include "SearchTrace.h"
 #include "Strategy.h"
+#include "TimeManager.h"
 
 
+class EvaluationWeights;
+
 struct MyConstants {
-	MyConstants(int cornerCost, int XFieldCost, int CFieldCost, double timeForMove) :
-		CORNER_COST(cornerCost), X_FIELD_COST(XFieldCost), C_FIELD_COST(CFieldCost), TIME_FOR_MOVE(timeForMove) {}
+	MyConstants(int cornerCost, int XFieldCost, int CFieldCost, double timeForMove, int maxDepth=0, uint64_t maxNodes=0,
+	            std::shared_ptr<const EvaluationWeights> weights=nullptr) :
+		CORNER_COST(cornerCost), X_FIELD_COST(XFieldCost), C_FIELD_COST(CFieldCost), TIME_FOR_MOVE(timeForMove),
+		MAX_DEPTH(maxDepth), MAX_NODES(maxNodes), WEIGHTS(weights) {}
+
+	bool hasTimeLimit() const {
+	    return TIME_FOR_MOVE > 0 || (MAX_DEPTH == 0 && MAX_NODES == 0);
+	}
+
 	int CORNER_COST;
 	int X_FIELD_COST; // X-field - position adjacent to a free corner diagonally
 	int C_FIELD_COST; // C-field - position adjacent to a free corner vertically or horizontally
-	double TIME_FOR_MOVE; // thinking time for one move in seconds
+	double TIME_FOR_MOVE; // thinking time for one move in seconds, ignored if not positive and other limit is set
+	int MAX_DEPTH; // maximal depth of iterative deepening, 0 - unlimited
+	uint64_t MAX_NODES; // maximal number of searched nodes for one move, 0 - unlimited
+	std::shared_ptr<const EvaluationWeights> WEIGHTS; // trained evaluation, replaces the costs above if not null
+	size_t TRANSPOSITION_TABLE_SIZE_LOG = 18; // transposition table has 2^TRANSPOSITION_TABLE_SIZE_LOG entries
+	bool LARGE_PAGES = false; // transposition table is placed in huge pages if the system allows it
+	size_t TRANSPOSITION_TABLE_THREADS = 1; // threads that initialize the table, more than 1 interleaves NUMA nodes
+	std::shared_ptr<EndgameCache> ENDGAME_CACHE; // exact scores of solved positions, may be shared by several strategies
+	size_t ENDGAME_CACHE_EMPTIES = 14; // only positions with at most this number of free fields are cached
+	std::shared_ptr<TraceFile> TRACE; // every searched node is recorded to it if not null
+	std::shared_ptr<const OpeningBook> OPENING_BOOK; // precomputed scores of opening positions, may be null
+};
+
+
+// Statistics of the last search
+struct SearchInfo {
+    SearchInfo() : depth(0), nodes(0), time(0) {}
+
+    int depth; // depth of the last completed iteration
+    uint64_t nodes; // number of visited nodes, including the unfinished iteration
+    double time; // in seconds
 };
 
 
@@ -39,42 +80,26 @@ public:
 class MobilityEstimator : public Estimator {
 public:
     int estimate(const Game& game, Color player) override {
-        int score = 0;
-
-		const Board& board = game.getBoard();
-		for (size_t x = 0; x < Board::X_DIM; x++)
-			for (size_t y = 0; y < Board::Y_DIM; y++) {
-                if (board[Position(x, y)] != FREE)
-                    continue;
-
-                int pos_value = 1;
-                if (Board::X_DIM == 8 && Board::Y_DIM == 8) {
-                    // count corners twice
-                    if ((x == 0 && y == 0) || (x == 0 && y == 7) ||
-                        (x == 7 && y == 0) || (x == 7 && y == 7))
-                        pos_value = 2;
-                    // do not count C and X fields if corner is free
-                    if ((x == 1 && y == 1 && board[Position(0, 0)] == FREE) ||
-                        (x == 1 && y == 6 && board[Position(0, 7)] == FREE) ||
-                        (x == 6 && y == 1 && board[Position(7, 0)] == FREE) ||
-                        (x == 6 && y == 6 && board[Position(7, 7)] == FREE) ||
-                        (x == 1 && y == 0 && board[Position(0, 0)] == FREE) ||
-                        (x == 0 && y == 1 && board[Position(0, 0)] == FREE) ||
-                        (x == 6 && y == 0 && board[Position(7, 0)] == FREE) ||
-                        (x == 7 && y == 1 && board[Position(7, 0)] == FREE) ||
-                        (x == 1 && y == 7 && board[Position(0, 7)] == FREE) ||
-                        (x == 0 && y == 6 && board[Position(0, 7)] == FREE) ||
-                        (x == 6 && y == 7 && board[Position(7, 7)] == FREE) ||
-                        (x == 7 && y == 6 && board[Position(7, 7)] == FREE))
-                        pos_value = 0;
-                }
+        const Board& board = game.getBoard();
+        Board::Bitboard ignored = getIgnoredFields(board);
+        return getMobility(board.getMoves(player), ignored) -
+               getMobility(board.getMoves(Game::getOppositeColor(player)), ignored);
+    }
 
-                if (game.isMovePossible(Move(Position(x, y), false), player))
-                    score += pos_value;
-                if (game.isMovePossible(Move(Position(x, y), false), Game::getOppositeColor(player)))
-                    score -= pos_value;
-            }
-        return score;
+    // C and X fields of free corners
+    static Board::Bitboard getIgnoredFields(const Board& board) {
+        Board::Bitboard empty = board.getEmpty();
+        Board::Bitboard ignored = 0;
+        for (size_t k = 0; k < Board::Geometry::CORNERS; k++)
+            if (empty & Board::Geometry::corner(k))
+                ignored |= Board::Geometry::xField(k) | Board::Geometry::cFields(k);
+        return ignored;
+    }
+
+private:
+    static int getMobility(Board::Bitboard moves, Board::Bitboard ignored) {
+        // count corners twice
+        return popCount(moves & ~ignored) + popCount(moves & Board::Geometry::corners());
     }
 };
 
@@ -87,28 +112,25 @@ public:
             XFieldCost(_XFieldCost), CFieldCost(_CFieldCost) {}
 
     static int countCorners(const Board& board, Color player) {
-        return ((board[Position(0, 0)] == player) +
-                (board[Position(0, 7)] == player) +
-                (board[Position(7, 0)] == player) +
-                (board[Position(7, 7)] == player));
+        return popCount(board.getStones(player) & Board::Geometry::corners());
     }
 
     static int countXFields(const Board& board, Color player) {
-        return ((board[Position(0, 0)] == Color::FREE && board[Position(1, 1)] == player) +
-                (board[Position(0, 7)] == Color::FREE && board[Position(1, 6)] == player) +
-                (board[Position(7, 0)] == Color::FREE && board[Position(6, 1)] == player) +
-                (board[Position(7, 7)] == Color::FREE && board[Position(6, 6)] == player));
+        Board::Bitboard empty = board.getEmpty();
+        int count = 0;
+        for (size_t k = 0; k < Board::Geometry::CORNERS; k++)
+            if (empty & Board::Geometry::corner(k))
+                count += popCount(board.getStones(player) & Board::Geometry::xField(k));
+        return count;
     }
 
     static int countCFields(const Board& board, Color player) {
-        return ((board[Position(0, 0)] == Color::FREE && board[Position(0, 1)] == player) +
-                (board[Position(0, 0)] == Color::FREE && board[Position(1, 0)] == player) +
-                (board[Position(0, 7)] == Color::FREE && board[Position(0, 6)] == player) +
-                (board[Position(0, 7)] == Color::FREE && board[Position(1, 7)] == player) +
-                (board[Position(7, 0)] == Color::FREE && board[Position(7, 1)] == player) +
-                (board[Position(7, 0)] == Color::FREE && board[Position(6, 0)] == player) +
-                (board[Position(7, 7)] == Color::FREE && board[Position(7, 6)] == player) +
-                (board[Position(7, 7)] == Color::FREE && board[Position(6, 7)] == player));
+        Board::Bitboard empty = board.getEmpty();
+        int count = 0;
+        for (size_t k = 0; k < Board::Geometry::CORNERS; k++)
+            if (empty & Board::Geometry::corner(k))
+                count += popCount(board.getStones(player) & Board::Geometry::cFields(k));
+        return count;
     }
 
     int estimate(const Game& game, Color player) override {
@@ -168,31 +190,123 @@ private:
 };
 
 
+// Linear evaluation with separate weights for every game stage.
+// Weights are fitted by Trainer to predict final score difference and stored in a text file:
+// first line contains number of stages and number of features, then one line of weights per stage.
+class EvaluationWeights {
+public:
+    enum Feature { CORNERS, X_FIELDS, C_FIELDS, MOBILITY, STONES, EDGES, FRONTIER, FEATURE_COUNT };
+
+    static const size_t STAGE_SIZE = 10; // number of placed stones in one stage
+
+    EvaluationWeights() : weights(getStageCount() * FEATURE_COUNT, 0.0) {}
+
+    static size_t getStageCount() {
+        return (Board::SIZE - 4 + STAGE_SIZE - 1) / STAGE_SIZE;
+    }
+
+    static size_t getStage(const Game& game) {
+        size_t placed = Board::SIZE - game.getAmountOfFreePositions() - 4;
+        return std::min(placed / STAGE_SIZE, getStageCount() - 1);
+    }
+
+    // Features are differences between player's and opponent's values.
+    static void getFeatures(const Game& game, Color player, int features[FEATURE_COUNT]) {
+        const Board& board = game.getBoard();
+        Color opponent = Game::getOppositeColor(player);
+        features[CORNERS] = PositionEstimator::countCorners(board, player) - PositionEstimator::countCorners(board, opponent);
+        features[X_FIELDS] = PositionEstimator::countXFields(board, player) - PositionEstimator::countXFields(board, opponent);
+        features[C_FIELDS] = PositionEstimator::countCFields(board, player) - PositionEstimator::countCFields(board, opponent);
+        features[MOBILITY] = MobilityEstimator().estimate(game, player);
+        features[STONES] = game.getScoreDifference(player);
+        features[EDGES] = popCount(board.getStones(player) & Board::Geometry::edges()) -
+                          popCount(board.getStones(opponent) & Board::Geometry::edges());
+        // frontier stones are adjacent to free positions, they give moves to opponent
+        Board::Bitboard frontier = Board::getNeighbours(board.getEmpty());
+        features[FRONTIER] = popCount(board.getStones(player) & frontier) - popCount(board.getStones(opponent) & frontier);
+    }
+
+    double& at(size_t stage, size_t feature) {
+        return weights[stage * FEATURE_COUNT + feature];
+    }
+
+    double at(size_t stage, size_t feature) const {
+        return weights[stage * FEATURE_COUNT + feature];
+    }
+
+    int estimate(const Game& game, Color player) const {
+        int features[FEATURE_COUNT];
+        getFeatures(game, player, features);
+        size_t stage = getStage(game);
+        double score = 0;
+        for (size_t i = 0; i < FEATURE_COUNT; i++)
+            score += at(stage, i) * features[i];
+        return int(std::lround(score));
+    }
+
+    // Returns nullptr if file can't be read or was trained for another board
+    static std::shared_ptr<EvaluationWeights> load(const std::string& fileName) {
+        std::ifstream in(fileName);
+        size_t stageCount, featureCount;
+        if (!(in >> stageCount >> featureCount) || stageCount != getStageCount() || featureCount != FEATURE_COUNT)
+            return nullptr;
+        std::shared_ptr<EvaluationWeights> result = std::make_shared<EvaluationWeights>();
+        for (double& weight : result->weights)
+            if (!(in >> weight))
+                return nullptr;
+        return result;
+    }
+
+    bool save(const std::string& fileName) const {
+        std::ofstream out(fileName);
+        out << getStageCount() << ' ' << FEATURE_COUNT << '\n';
+        for (size_t stage = 0; stage < getStageCount(); stage++) {
+            for (size_t i = 0; i < FEATURE_COUNT; i++)
+                out << (i == 0 ? "" : " ") << at(stage, i);
+            out << '\n';
+        }
+        return bool(out);
+    }
+
+private:
+    std::vector<double> weights;
+};
+
+
 class MyEstimator : public Estimator {
 public:
-    MyEstimator(int cornerCost, int XFieldCost, int CFieldCost) : openingEstimator(cornerCost, XFieldCost, CFieldCost),
-        middlegameEstimator(cornerCost, XFieldCost, CFieldCost), endgameEstimator(cornerCost, XFieldCost) {}
+    MyEstimator(int cornerCost, int XFieldCost, int CFieldCost, std::shared_ptr<const EvaluationWeights> _weights=nullptr) :
+        openingEstimator(cornerCost, XFieldCost, CFieldCost), middlegameEstimator(cornerCost, XFieldCost, CFieldCost),
+        endgameEstimator(cornerCost, XFieldCost), weights(_weights) {}
 
     int estimate(const Game& game, Color player) override  {
         if (game.isGameFinished())
             return scoreEstimator.estimate(game, player);
-        else if (game.getMoveNumber() < 20)
+        else if (weights)
+            return weights->estimate(game, player);
+        else if (game.getMoveNumber() < OPENING_END)
             return openingEstimator.estimate(game, player);
-        else if (game.getMoveNumber() < 40)
+        else if (game.getMoveNumber() < MIDDLEGAME_END)
             return middlegameEstimator.estimate(game, player);
         else
             return endgameEstimator.estimate(game, player);
 	}
+
+    // Phases take a third of the moves each, 20 and 40 on the standard board
+    static const size_t OPENING_END = (Board::SIZE - 4) / 3;
+    static const size_t MIDDLEGAME_END = 2 * (Board::SIZE - 4) / 3;
+
 private:
     OpeningEstimator openingEstimator;
     MiddlegameEstimator middlegameEstimator;
     EndgameEstimator endgameEstimator;
     ScoreEstimator scoreEstimator;
+    std::shared_ptr<const EvaluationWeights> weights;
 };
 
 
 struct SearchResult {
-    SearchResult() {}
+    SearchResult() : score(0), isFinished(false), isValid(false) {}
 
     SearchResult(int bestScore, bool isGameFinished, Move bestMove=Move()) :
         score(bestScore), isFinished(isGameFinished), move(bestMove), isValid(true) {}
@@ -255,158 +369,542 @@ struct SearchResult {
     }
 };
 
-// Stores best move for board state
+// Result of analysis of one move in the root position
+struct MoveAnalysis {
+    enum Bound {
+        EXACT,
+        UPPER // the real score is not greater than score
+    };
+
+    MoveAnalysis(Move _move) : move(_move), score(0), isFinished(false), bound(UPPER), depth(0) {}
+
+    Move move;
+    int score; // from the point of view of the player to move
+    bool isFinished;
+    Bound bound;
+    int depth; // 0 if the move was not searched in time
+    std::vector<Move> principalVariation; // starts with move
+};
+
+
+// Stores best move for board state.
+// Table has fixed size and is allocated once, so search does not allocate memory.
+// New entry replaces the old one with the same index.
+// Large tables should be placed in huge pages (see LargeArray), random probes of 4 KB pages miss the TLB.
 class TranspositionTable {
 public:
-    bool isPositionStored(const Board& board) const {
-        return transpositionTable.count(board) != 0;
+    static const size_t MIN_SIZE_LOG = 1;
+    static const size_t MAX_SIZE_LOG = 40;
+
+    // sizeLog is clamped to [MIN_SIZE_LOG, MAX_SIZE_LOG]. Throws std::bad_alloc if the table can't be allocated.
+    TranspositionTable(size_t sizeLog, bool largePages=false, size_t initThreads=1) :
+        shift(64 - clampSizeLog(sizeLog)), entries(size_t(1) << clampSizeLog(sizeLog), largePages, initThreads) {}
+
+    static size_t clampSizeLog(size_t sizeLog) {
+        return sizeLog < MIN_SIZE_LOG ? MIN_SIZE_LOG : sizeLog > MAX_SIZE_LOG ? MAX_SIZE_LOG : sizeLog;
+    }
+
+    // Returns false if there is no move stored for the board
+    bool retrieve(const Board& board, Move& move) const {
+        uint64_t key = board.hash();
+        const Entry& entry = entries[getIndex(key)];
+        if (entry.move == NO_MOVE || entry.key != key)
+            return false;
+        if (entry.move == PASS)
+            move = Move();
+        else
+            move = Move(Position(entry.move / Board::Y_DIM, entry.move % Board::Y_DIM), false);
+        return true;
     }
 
     void store(const Board& board, Move move) {
-        transpositionTable[board] = move;
+        uint64_t key = board.hash();
+        Entry& entry = entries[getIndex(key)];
+        entry.key = key;
+        entry.move = move.isPass ? PASS : uint16_t(move.pos.x() * Board::Y_DIM + move.pos.y());
     }
 
-    Move retrieve(const Board& board) {
-        return transpositionTable[board];
+    PageKind getPageKind() const {
+        return entries.getPageKind();
     }
 
 private:
-    std::unordered_map< Board, Move, BoardHasher > transpositionTable;
+    static const uint16_t PASS = Board::SIZE;
+    static const uint16_t NO_MOVE = PASS + 1;
+
+    struct Entry {
+        Entry() : key(0), move(NO_MOVE) {}
+
+        uint64_t key;
+        uint16_t move;
+    };
+
+    size_t shift;
+    LargeArray<Entry> entries;
+
+    size_t getIndex(uint64_t key) const {
+        // multiplicative hashing spreads positions that differ only in a few fields
+        return size_t((key * 0x9E3779B97F4A7C15ULL) >> shift);
+    }
 };
 
 
 class MyStrategy : public Strategy {
 public:
 	explicit MyStrategy(MyConstants myConstants) : constants(myConstants),
-        myEstimator(myConstants.CORNER_COST, myConstants.X_FIELD_COST, myConstants.C_FIELD_COST) {}
+        myEstimator(myConstants.CORNER_COST, myConstants.X_FIELD_COST, myConstants.C_FIELD_COST, myConstants.WEIGHTS),
+        transpositionTable(myConstants.TRANSPOSITION_TABLE_SIZE_LOG, myConstants.LARGE_PAGES,
+                           myConstants.TRANSPOSITION_TABLE_THREADS), hasDeadline(true), nodeLimit(0),
+        isDepthLimitReached(false), control(nullptr), activeControl(nullptr),
+        tracer(myConstants.TRACE ? new SearchTracer(myConstants.TRACE) : nullptr), rootMoveNumber(0) {}
 
 	Move makeMove(const Game& game) override {
-		Game gameCopy(game);
+		if (timeManager)
+			return makeTimedMove(game);
+		if (game.getMoveNumber() == 0 || (constants.hasTimeLimit() && constants.TIME_FOR_MOVE < 0.001))
+            return makeUnsearchedMove(game);
+
+        return search(game).move;
+	}
 
-		if (game.getMoveNumber() == 0 || constants.TIME_FOR_MOVE < 0.001)
-            return game.getPossibleMoves(game.getCurrentColor())[0];
+    // Searches the current position and returns the best move together with its score
+    // (from the point of view of the player to move).
+    // Search stops on time, depth or node limit, whichever comes first. Depth and node limits make it deterministic.
+    // Positions of the opening book are not searched, their stored result is returned at once.
+    SearchResult search(const Game& game) {
+        Game gameCopy(game);
+        gameCopy.reserveHistory();
+        Clock::time_point startTime = startSearch(game);
+
+        // positions of the opening book are already searched
+        int bookScore;
+        Move bookMove;
+        if (constants.OPENING_BOOK && constants.OPENING_BOOK->lookup(game, bookScore, bookMove)) {
+            MoveList moves = game.getPossibleMoves(game.getCurrentColor());
+            if (std::find(moves.begin(), moves.end(), bookMove) != moves.end()) {
+                info.depth = constants.OPENING_BOOK->getDepth();
+                info.time = finishSearch(startTime, bookScore);
+                return SearchResult(bookScore, false, bookMove);
+            }
+        }
 
         // iterative deepening
         SearchResult result;
-        double remainingTime = constants.TIME_FOR_MOVE - 0.001;
         int depth = 1;
         do {
-            clock_t startClock = clock();
+            if (constants.MAX_DEPTH != 0 && depth > constants.MAX_DEPTH)
+                break;
+
+            isDepthLimitReached = false;
             SearchResult newResult = PVS(gameCopy,
                                          SearchResult(-1000000, true),
                                          SearchResult(1000000, true),
-                                         depth, remainingTime);
-            remainingTime -= double (clock() - startClock + 0.0L) / CLOCKS_PER_SEC;
+                                         depth);
 
-            if (!newResult.isValid) // happens when thinking time is over
+            if (!newResult.isValid) // happens when thinking time or node limit is over
                 break;
             result = newResult;
+            info.depth = depth;
+
+            // no leaf was cut by the depth, so the score is exact
+            if (!isDepthLimitReached) {
+                storeInEndgameCache(game, result);
+                break;
+            }
 
             depth++;
         } while(!result.isFinished);
 
-        return result.move;
-	}
+        // not even the first iteration has finished in time
+        if (!result.isValid)
+            result = SearchResult(0, false, game.getPossibleMoves(game.getCurrentColor())[0]);
+
+        info.time = finishSearch(startTime, result.score);
+        return result;
+    }
+
+    // Best line after firstMove as stored by the last search, at most length moves including firstMove
+    std::vector<Move> getPrincipalVariation(const Game& game, Move firstMove, int length) {
+        Game gameCopy(game);
+        gameCopy.reserveHistory();
+        return followPrincipalVariation(gameCopy, firstMove, length);
+    }
+
+    // Searches every move in the current position.
+    // Exact scores are found for the best multiPV moves, other moves get upper bounds.
+    // Moves are sorted from the best to the worst, limits are the same as for search.
+    std::vector<MoveAnalysis> analyze(const Game& game, size_t multiPV) {
+        Game gameCopy(game);
+        gameCopy.reserveHistory();
+        Clock::time_point startTime = startSearch(game);
+        multiPV = std::max<size_t>(multiPV, 1);
+
+        // a finished game has no moves to analyze, but still ends as any other search
+        std::vector<MoveAnalysis> analysis;
+        if (!game.isGameFinished())
+            for (Move move : getPossibleMovesInGoodOrder(gameCopy, gameCopy.getCurrentColor()))
+                analysis.push_back(MoveAnalysis(move));
+
+        // iterative deepening, moves are searched in the order of the previous iteration
+        for (int depth = 1; !analysis.empty() && (constants.MAX_DEPTH == 0 || depth <= constants.MAX_DEPTH); depth++) {
+            std::vector<MoveAnalysis> iteration;
+            std::vector<SearchResult> exactResults;
+            for (const MoveAnalysis& previous : analysis) {
+                // only moves better than the multiPV-th exact result need exact scores
+                bool hasBound = exactResults.size() >= multiPV;
+                SearchResult alpha = hasBound ? exactResults[multiPV - 1] : SearchResult(-1000000, true);
+                SearchResult beta(1000000, true);
+
+                gameCopy.makeMove(previous.move);
+                SearchResult result;
+                if (hasBound) {
+                    result = -PVS(gameCopy, -alpha - 1, -alpha, depth - 1);
+                    if (result.isValid && result > alpha)
+                        result = -PVS(gameCopy, -beta, -alpha, depth - 1);
+                } else
+                    result = -PVS(gameCopy, -beta, -alpha, depth - 1);
+                gameCopy.cancelMove();
+
+                if (!result.isValid) // thinking time or node limit is over
+                    break;
+
+                MoveAnalysis current(previous.move);
+                current.score = result.score;
+                current.isFinished = result.isFinished;
+                current.bound = hasBound && result <= alpha ? MoveAnalysis::UPPER : MoveAnalysis::EXACT;
+                current.depth = depth;
+                iteration.push_back(current);
+                if (current.bound == MoveAnalysis::EXACT) {
+                    exactResults.push_back(result);
+                    std::sort(exactResults.begin(), exactResults.end(),
+                              [](const SearchResult& a, const SearchResult& b) { return a > b; });
+                }
+            }
+            if (iteration.size() != analysis.size())
+                break;
+
+            std::stable_sort(iteration.begin(), iteration.end(), [](const MoveAnalysis& a, const MoveAnalysis& b) {
+                SearchResult resultA(a.score, a.isFinished), resultB(b.score, b.isFinished);
+                if (resultA > resultB || resultA < resultB)
+                    return resultA > resultB;
+                return a.bound < b.bound;
+            });
+            analysis.swap(iteration);
+            info.depth = depth;
+
+            bool isFinished = true;
+            for (size_t i = 0; i < std::min(multiPV, analysis.size()); i++)
+                isFinished &= analysis[i].isFinished;
+            if (isFinished)
+                break;
+        }
+
+        for (MoveAnalysis& moveAnalysis : analysis)
+            if (moveAnalysis.depth != 0)
+                moveAnalysis.principalVariation = followPrincipalVariation(gameCopy, moveAnalysis.move, moveAnalysis.depth);
+            else
+                moveAnalysis.principalVariation.push_back(moveAnalysis.move);
+
+        int score = analysis.empty() ? game.getScoreDifference(game.getCurrentColor()) : analysis[0].score;
+        info.time = finishSearch(startTime, score);
+        return analysis;
+    }
+
+    // Searches the position till the end of the game ignoring all limits.
+    // Returns exact score difference and the best move.
+    SearchResult solve(const Game& game) {
+        Game gameCopy(game);
+        gameCopy.reserveHistory();
+        Clock::time_point startTime = Clock::now();
+
+        info = SearchInfo();
+        hasDeadline = false;
+        nodeLimit = 0;
+        activeControl = nullptr;
+        rootMoveNumber = game.getMoveNumber();
+        // every move except pass takes one free position and there can't be more than two passes in a row
+        info.depth = int(2 * game.getAmountOfFreePositions() + 2);
+        SearchResult result = PVS(gameCopy, SearchResult(-1000000, true), SearchResult(1000000, true), info.depth);
+        storeInEndgameCache(game, result);
+        info.time = finishSearch(startTime, result.score);
+        return result;
+    }
+
+    // Thinking time of makeMove is allocated by the manager instead of TIME_FOR_MOVE.
+    // The manager is corrected by the deadline of the search control if the control has one.
+    void setTimeManager(const TimeManager& manager) {
+        timeManager.reset(new TimeManager(manager));
+    }
+
+    const TimeManager* getTimeManager() const {
+        return timeManager.get();
+    }
+
+    // Search and analysis stop on requests of the control too. It is reset when a search finishes.
+    void setSearchControl(SearchControl* searchControl) {
+        control = searchControl;
+    }
+
+    void setLimits(double timeForMove, int maxDepth, uint64_t maxNodes) {
+        constants.TIME_FOR_MOVE = timeForMove;
+        constants.MAX_DEPTH = maxDepth;
+        constants.MAX_NODES = maxNodes;
+    }
+
+    const SearchInfo& getSearchInfo() const {
+        return info;
+    }
+
+    PageKind getTranspositionTablePageKind() const {
+        return transpositionTable.getPageKind();
+    }
 
 private:
+    // wall clock is used so that several searches can run in parallel threads
+    typedef std::chrono::steady_clock Clock;
+
 	MyConstants constants;
 	MyEstimator myEstimator;
 	TranspositionTable transpositionTable;
+	Clock::time_point deadline;
+	bool hasDeadline;
+	uint64_t nodeLimit;
+	bool isDepthLimitReached; // some leaf of the last search was not the end of the game
+	SearchControl* control;
+	SearchControl* activeControl; // control of the current search, solve ignores it
+	std::unique_ptr<SearchTracer> tracer;
+	size_t rootMoveNumber;
+	std::unique_ptr<TimeManager> timeManager;
+	SearchInfo info;
+
+	// Resets statistics and sets limits from constants. Returns start time.
+	Clock::time_point startSearch(const Game& game) {
+	    Clock::time_point startTime = Clock::now();
+	    info = SearchInfo();
+	    hasDeadline = constants.hasTimeLimit();
+	    nodeLimit = constants.MAX_NODES;
+	    activeControl = control;
+	    rootMoveNumber = game.getMoveNumber();
+	    deadline = startTime + std::chrono::duration_cast<Clock::duration>(
+	            std::chrono::duration<double>(constants.TIME_FOR_MOVE - 0.001));
+	    return startTime;
+	}
+
+	Move makeTimedMove(const Game& game) {
+	    Clock::time_point startTime = Clock::now();
+	    Clock::time_point controlDeadline;
+	    if (control && control->getDeadline(controlDeadline))
+	        timeManager->setTimeLeft(std::chrono::duration<double>(controlDeadline - startTime).count());
+
+	    Move move;
+	    double time = timeManager->allocate(game);
+	    if (time == 0) // forced move
+	        move = makeUnsearchedMove(game);
+	    else {
+	        constants.TIME_FOR_MOVE = time;
+	        move = search(game).move;
+	    }
+	    timeManager->finishMove(std::chrono::duration<double>(Clock::now() - startTime).count());
+	    return move;
+	}
+
+	// Plays the first legal move. Requests of the control were meant for this move, so they are dropped
+	// as at the end of a search, otherwise a deadline or stop would cut the next search short.
+	Move makeUnsearchedMove(const Game& game) {
+	    if (control)
+	        control->reset();
+	    return game.getPossibleMoves(game.getCurrentColor())[0];
+	}
+
+	// Finishes statistics and resets the control. Returns elapsed time.
+	double finishSearch(Clock::time_point startTime, int score) {
+	    if (activeControl)
+	        activeControl->reset();
+	    double time = std::chrono::duration<double>(Clock::now() - startTime).count();
+	    if (tracer) {
+	        TraceRecord record = TraceRecord();
+	        record.score = score;
+	        record.time = uint32_t(std::min(time * 1e6, 4e9));
+	        record.flags = TraceRecord::SEARCH;
+	        tracer->add(record);
+	        tracer->flush();
+	    }
+	    return time;
+	}
+
+	void traceNode(const Game& game, int alpha, int beta, int subtreeDepth, int score, size_t moveCount,
+	               size_t cutoffIndex, uint8_t flags, uint32_t time=0) {
+	    TraceRecord record = TraceRecord();
+	    record.alpha = alpha;
+	    record.beta = beta;
+	    record.score = score;
+	    record.time = time;
+	    record.ply = uint8_t(std::min<size_t>(game.getMoveNumber() - rootMoveNumber, 255));
+	    record.depth = int8_t(std::max(std::min(subtreeDepth, 127), -128));
+	    record.moveCount = uint8_t(moveCount);
+	    record.cutoffIndex = uint8_t(cutoffIndex);
+	    record.flags = flags;
+	    record.move = game.getMoveNumber() == rootMoveNumber ? TraceRecord::NO_MOVE :
+	                                                          TraceRecord::encodeMove(game.getMoves().back());
+	    tracer->add(record);
+	}
+
+	bool isSearchStopped() const {
+	    if (nodeLimit != 0 && info.nodes >= nodeLimit)
+	        return true;
+	    if (!hasDeadline && !activeControl)
+	        return false;
+	    Clock::time_point now = Clock::now();
+	    return (hasDeadline && now >= deadline) || (activeControl && activeControl->isStopped(now));
+	}
+
+	bool isInEndgameCache(const Game& game) const {
+	    return constants.ENDGAME_CACHE && game.getAmountOfFreePositions() <= constants.ENDGAME_CACHE_EMPTIES;
+	}
+
+	void storeInEndgameCache(const Game& game, const SearchResult& result) {
+	    if (result.isValid && !game.isGameFinished() && isInEndgameCache(game))
+	        constants.ENDGAME_CACHE->store(game, result.score, result.move);
+	}
+
+	// Follows best moves stored in transposition table
+	std::vector<Move> followPrincipalVariation(Game& game, Move firstMove, int length) {
+	    std::vector<Move> variation(1, firstMove);
+	    game.makeMove(firstMove);
+	    Move move;
+	    while (int(variation.size()) < length && !game.isGameFinished() &&
+	           transpositionTable.retrieve(game.getBoard(), move)) {
+	        MoveList moves = game.getPossibleMoves(game.getCurrentColor());
+	        if (std::find(moves.begin(), moves.end(), move) == moves.end())
+	            break;
+	        variation.push_back(move);
+	        game.makeMove(move);
+	    }
+	    for (size_t i = 0; i < variation.size(); i++)
+	        game.cancelMove();
+	    return variation;
+	}
 
 	static bool isCornerField(const Board& board, Position pos) {
-        return (pos == Position(0, 0) ||
-                pos == Position(0, 7) ||
-                pos == Position(7, 0) ||
-                pos == Position(7, 7));
+        return (Board::getBit(pos) & Board::Geometry::corners()) != 0;
 	}
 
 	static bool isXField(const Board& board, Position pos) {
-        return (pos == Position(1, 1) && board[Position(0, 0)] == FREE) ||
-               (pos == Position(6, 1) && board[Position(7, 0)] == FREE) ||
-               (pos == Position(1, 6) && board[Position(0, 7)] == FREE) ||
-               (pos == Position(6, 6) && board[Position(7, 7)] == FREE);
+	    Board::Bitboard empty = board.getEmpty();
+	    for (size_t k = 0; k < Board::Geometry::CORNERS; k++)
+	        if ((empty & Board::Geometry::corner(k)) && (Board::getBit(pos) & Board::Geometry::xField(k)))
+	            return true;
+	    return false;
 	}
 
-    static bool isEdgeField(const Board& board, Position pos) {
-        return pos.x() == 0 || pos.x() == 7 || pos.y() == 0 || pos.y() == 7;
-    }
-
-	std::vector<Move> getPossibleMovesInGoodOrder(const Game& game, Color player) {
-        std::vector<Move> moves = game.getPossibleMoves(player);
+	MoveList getPossibleMovesInGoodOrder(const Game& game, Color player) {
+        MoveList moves = game.getPossibleMoves(player);
 
         if (moves.size() == 1 && moves[0].isPass)
             return moves;
 
-        if (Board::X_DIM != 8 || Board::Y_DIM != 8)
-            return moves;
-
-        std::vector<Move> reorderedMoves[7];
+        // Moves are sorted by priority from 0 (the most promising) to 6
+        int priorities[Board::SIZE];
 
         // First we check the move which was stored in transposition table
-        bool isRetrievedMovePossible = false;
-        if (transpositionTable.isPositionStored(game.getBoard())) {
-            Move retrievedMove = transpositionTable.retrieve(game.getBoard());
-            for (size_t i = 0; i < moves.size(); i++)
-                if (retrievedMove == moves[i]) {
-                    std::swap(moves[i], moves[0]);
-                    isRetrievedMovePossible = true;
-                    reorderedMoves[0].push_back(retrievedMove);
-                    break;
-                }
-        }
+        Move retrievedMove;
+        bool isMoveRetrieved = transpositionTable.retrieve(game.getBoard(), retrievedMove);
 
-        for (size_t i = isRetrievedMovePossible; i < moves.size(); i++) {
-            if (game.isMovePossible(moves[i], Game::getOppositeColor(player))) {
+        for (size_t i = 0; i < moves.size(); i++) {
+            if (isMoveRetrieved && retrievedMove == moves[i])
+                priorities[i] = 0;
+            else if (game.isMovePossible(moves[i], Game::getOppositeColor(player))) {
                 if (isCornerField(game.getBoard(), moves[i].pos)) // If opponent can take corner, the move is important
-                    reorderedMoves[1].push_back(moves[i]);
+                    priorities[i] = 1;
                 else if (isXField(game.getBoard(), moves[i].pos)) // No one wants to take X-field
-                    reorderedMoves[6].push_back(moves[i]);
+                    priorities[i] = 6;
                 else
-                    reorderedMoves[3].push_back(moves[i]);
+                    priorities[i] = 3;
             } else {
                 if (isCornerField(game.getBoard(), moves[i].pos)) // If we can take corner, but opponent can not
-                    reorderedMoves[2].push_back(moves[i]);
+                    priorities[i] = 2;
                 else if (isXField(game.getBoard(), moves[i].pos)) // Don't want to take X field
-                    reorderedMoves[5].push_back(moves[i]);
+                    priorities[i] = 5;
                 else
-                    reorderedMoves[4].push_back(moves[i]);
+                    priorities[i] = 4;
             }
         }
 
-        size_t i = 0;
-        for (size_t k = 0; k < 7; k++)
-            for (size_t j = 0; j < reorderedMoves[k].size(); j++, i++)
-                moves[i] = reorderedMoves[k][j];
+        // stable insertion sort, there are only a few moves
+        for (size_t i = 1; i < moves.size(); i++) {
+            Move move = moves[i];
+            int priority = priorities[i];
+            size_t j = i;
+            for (; j > 0 && priorities[j - 1] > priority; j--) {
+                moves[j] = moves[j - 1];
+                priorities[j] = priorities[j - 1];
+            }
+            moves[j] = move;
+            priorities[j] = priority;
+        }
         return moves;
     }
 
     // Principal Variation Search
-    SearchResult PVS(Game& game, SearchResult alpha, SearchResult beta, int subtreeDepth, double remainingTime) {
-        if (remainingTime < 0)
+    SearchResult PVS(Game& game, SearchResult alpha, SearchResult beta, int subtreeDepth) {
+        NoAllocationScope noAllocations;
+        if (isSearchStopped())
             return SearchResult(false);
-        clock_t startClock = clock();
+        info.nodes++;
+        int windowAlpha = alpha.score, windowBeta = beta.score;
+
+        if (game.isGameFinished()) {
+            int score = game.getScoreDifference(game.getCurrentColor());
+            if (tracer)
+                traceNode(game, windowAlpha, windowBeta, subtreeDepth, score, 0, TraceRecord::NO_CUTOFF, TraceRecord::FINISHED);
+            return SearchResult(score, true);
+        }
+
+        int cachedScore;
+        Move cachedMove;
+        if (isInEndgameCache(game) && constants.ENDGAME_CACHE->lookup(game, cachedScore, cachedMove)) {
+            if (tracer)
+                traceNode(game, windowAlpha, windowBeta, subtreeDepth, cachedScore, 0, TraceRecord::NO_CUTOFF, TraceRecord::CACHED);
+            return SearchResult(cachedScore, true, cachedMove);
+        }
 
-		if (subtreeDepth <= 0 || game.isGameFinished())
-			return SearchResult(myEstimator.estimate(game, game.getCurrentColor()), game.isGameFinished());
+		if (subtreeDepth <= 0) {
+		    isDepthLimitReached = true;
+		    // score of the deep search from the opening book replaces the static estimation
+		    int bookScore;
+		    Move bookMove;
+		    if (constants.OPENING_BOOK && constants.OPENING_BOOK->lookup(game, bookScore, bookMove)) {
+		        if (tracer)
+		            traceNode(game, windowAlpha, windowBeta, subtreeDepth, bookScore, 0, TraceRecord::NO_CUTOFF, TraceRecord::BOOK);
+		        return SearchResult(bookScore, false);
+		    }
+
+		    if (!tracer)
+			    return SearchResult(myEstimator.estimate(game, game.getCurrentColor()), false);
+
+		    Clock::time_point startTime = Clock::now();
+		    int score = myEstimator.estimate(game, game.getCurrentColor());
+		    uint32_t time = uint32_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - startTime).count());
+		    traceNode(game, windowAlpha, windowBeta, subtreeDepth, score, 0, TraceRecord::NO_CUTOFF, TraceRecord::EVALUATED, time);
+		    return SearchResult(score, false);
+		}
 
         bool zeroWindowMode = false;
         // order is very important for alpha-beta pruning
-        std::vector<Move> moves = getPossibleMovesInGoodOrder(game, game.getCurrentColor());
+        MoveList moves = getPossibleMovesInGoodOrder(game, game.getCurrentColor());
         alpha.move = moves[0];
 
-		for (Move move : moves) {
+		for (size_t i = 0; i < moves.size(); i++) {
+		    Move move = moves[i];
             SearchResult result;
 
 			game.makeMove(move);
 			if (zeroWindowMode) {
-                result = -PVS(game, -alpha - 1, -alpha, subtreeDepth - 1,
-                              remainingTime - double(clock() - startClock) / CLOCKS_PER_SEC);
+                result = -PVS(game, -alpha - 1, -alpha, subtreeDepth - 1);
                 if (result > alpha)
-                    result = -PVS(game, -beta, -alpha, subtreeDepth - 1,
-                                  remainingTime - double(clock() - startClock) / CLOCKS_PER_SEC);
+                    result = -PVS(game, -beta, -alpha, subtreeDepth - 1);
             } else {
-                result = -PVS(game, -beta, -alpha, subtreeDepth - 1,
-                              remainingTime - double(clock() - startClock) / CLOCKS_PER_SEC);
+                result = -PVS(game, -beta, -alpha, subtreeDepth - 1);
             }
 			game.cancelMove();
 
@@ -416,6 +914,8 @@ private:
             if (result >= beta) {
                 transpositionTable.store(game.getBoard(), move);
                 beta.move = move;
+                if (tracer)
+                    traceNode(game, windowAlpha, windowBeta, subtreeDepth, beta.score, moves.size(), i, 0);
                 return beta;
             }
             if (result > alpha) {
@@ -426,6 +926,8 @@ private:
 		}
 
 		transpositionTable.store(game.getBoard(), alpha.move);
+		if (tracer)
+		    traceNode(game, windowAlpha, windowBeta, subtreeDepth, alpha.score, moves.size(), TraceRecord::NO_CUTOFF, 0);
         return alpha;
     }
 };
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "Game.h"
+
+
+// Symmetries of the board: 8 for square boards (rotations and reflections), 4 for rectangular ones.
+// Positions that differ only by a symmetry have the same score, so tables store only the canonical one -
+// the smallest image of the position.
+class BoardSymmetry {
+public:
+    static size_t count() {
+        return Board::X_DIM == Board::Y_DIM ? 8 : 4;
+    }
+
+    static Board::Bitboard transform(Board::Bitboard stones, size_t symmetry) {
+        Board::Bitboard result = 0;
+        for (; stones != 0; stones &= stones - 1)
+            result |= Board::Bitboard(1) << getTables().forward[symmetry][lowestBitIndex(stones)];
+        return result;
+    }
+
+    static size_t transformIndex(size_t index, size_t symmetry) {
+        return getTables().forward[symmetry][index];
+    }
+
+    static size_t inverseIndex(size_t index, size_t symmetry) {
+        return getTables().inverse[symmetry][index];
+    }
+
+private:
+    struct Tables {
+        uint8_t forward[8][Board::SIZE];
+        uint8_t inverse[8][Board::SIZE];
+    };
+
+    static const Tables& getTables() {
+        static const Tables tables = makeTables();
+        return tables;
+    }
+
+    static Tables makeTables() {
+        Tables tables;
+        for (size_t symmetry = 0; symmetry < count(); symmetry++)
+            for (size_t x = 0; x < Board::X_DIM; x++)
+                for (size_t y = 0; y < Board::Y_DIM; y++) {
+                    // bit 0 flips rows, bit 1 flips columns, bit 2 transposes (square boards only)
+                    size_t newX = symmetry & 1 ? Board::X_DIM - 1 - x : x;
+                    size_t newY = symmetry & 2 ? Board::Y_DIM - 1 - y : y;
+                    if (symmetry & 4)
+                        std::swap(newX, newY);
+                    size_t from = x * Board::Y_DIM + y, to = newX * Board::Y_DIM + newY;
+                    tables.forward[symmetry][from] = uint8_t(to);
+                    tables.inverse[symmetry][to] = uint8_t(from);
+                }
+        return tables;
+    }
+};
+
+
+// Position up to symmetry, ordered so that tables of positions can be sorted and searched
+struct PositionKey {
+    Board::Bitboard stones[2];
+    uint8_t sideToMove;
+
+    // Canonical key of the position, symmetry maps the position to it
+    static PositionKey make(const Game& game, size_t& symmetry) {
+        PositionKey best;
+        memset(&best, 0, sizeof(best));
+        for (size_t s = 0; s < BoardSymmetry::count(); s++) {
+            PositionKey key;
+            memset(&key, 0, sizeof(key));
+            key.stones[BLACK] = BoardSymmetry::transform(game.getBoard().getStones(BLACK), s);
+            key.stones[WHITE] = BoardSymmetry::transform(game.getBoard().getStones(WHITE), s);
+            key.sideToMove = uint8_t(game.getCurrentColor());
+            if (s == 0 || key < best) {
+                best = key;
+                symmetry = s;
+            }
+        }
+        return best;
+    }
+
+    bool operator < (const PositionKey& other) const {
+        if (stones[BLACK] != other.stones[BLACK])
+            return stones[BLACK] < other.stones[BLACK];
+        if (stones[WHITE] != other.stones[WHITE])
+            return stones[WHITE] < other.stones[WHITE];
+        return sideToMove < other.sideToMove;
+    }
+
+    bool operator == (const PositionKey& other) const {
+        return stones[BLACK] == other.stones[BLACK] && stones[WHITE] == other.stones[WHITE] &&
+               sideToMove == other.sideToMove;
+    }
+};
+
+
+// Table of precomputed search results for all positions of the first plies, built by OpeningEnumerator.
+// Every position is stored once for all its symmetric images, sorted by key, and found by binary search.
+class OpeningBook {
+public:
+    struct Entry {
+        PositionKey key;
+        int16_t score; // from the point of view of the player to move
+        uint8_t move; // best move in the canonical position, index of the field or PASS
+
+        bool operator < (const Entry& other) const {
+            return key < other.key;
+        }
+    };
+
+    static const uint8_t PASS = 0xFF;
+
+    OpeningBook(size_t _maxPly, int _depth, std::vector<Entry> _entries) :
+        maxPly(_maxPly), depth(_depth), entries(std::move(_entries)) {
+        std::sort(entries.begin(), entries.end());
+    }
+
+    // Returns nullptr if the file can't be read or was built for another board
+    static std::shared_ptr<const OpeningBook> load(const std::string& fileName) {
+        FILE* file = fopen(fileName.c_str(), "rb");
+        if (!file)
+            return nullptr;
+        Header header;
+        std::vector<Entry> entries;
+        bool isCorrect = fread(&header, sizeof(header), 1, file) == 1 && header.isCompatible();
+        if (isCorrect) {
+            entries.resize(header.count);
+            isCorrect = fread(entries.data(), sizeof(Entry), entries.size(), file) == entries.size();
+        }
+        fclose(file);
+        if (!isCorrect)
+            return nullptr;
+        return std::make_shared<OpeningBook>(header.maxPly, header.depth, std::move(entries));
+    }
+
+    bool save(const std::string& fileName) const {
+        FILE* file = fopen(fileName.c_str(), "wb");
+        if (!file)
+            return false;
+        bool isWritten = writeHeader(file, maxPly, depth, entries.size()) &&
+                         fwrite(entries.data(), sizeof(Entry), entries.size(), file) == entries.size();
+        return fclose(file) == 0 && isWritten;
+    }
+
+    // Book file is the header followed by count entries sorted by key
+    static bool writeHeader(FILE* file, size_t maxPly, int depth, uint64_t count) {
+        Header header = Header::make(maxPly, depth, count);
+        return fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+
+    bool lookup(const Game& game, int& score, Move& move) const {
+        if (game.getMoveNumber() > maxPly)
+            return false;
+        Entry entry;
+        size_t symmetry;
+        entry.key = PositionKey::make(game, symmetry);
+        auto it = std::lower_bound(entries.begin(), entries.end(), entry);
+        if (it == entries.end() || !(it->key == entry.key))
+            return false;
+        score = it->score;
+        if (it->move == PASS)
+            move = Move();
+        else {
+            size_t index = BoardSymmetry::inverseIndex(it->move, symmetry);
+            move = Move(Position(index / Board::Y_DIM, index % Board::Y_DIM), false);
+        }
+        return true;
+    }
+
+    size_t getMaxPly() const {
+        return maxPly;
+    }
+
+    int getDepth() const {
+        return depth;
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t boardXDim;
+        uint32_t boardYDim;
+        uint32_t entrySize;
+        uint32_t maxPly;
+        int32_t depth;
+        uint64_t count;
+
+        static Header make(size_t maxPly, int depth, uint64_t count) {
+            Header header;
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, "OTHBOOK", 8);
+            header.version = 1;
+            header.boardXDim = Board::X_DIM;
+            header.boardYDim = Board::Y_DIM;
+            header.entrySize = sizeof(Entry);
+            header.maxPly = uint32_t(maxPly);
+            header.depth = depth;
+            header.count = count;
+            return header;
+        }
+
+        bool isCompatible() const {
+            return memcmp(magic, "OTHBOOK", 8) == 0 && version == 1 && boardXDim == Board::X_DIM &&
+                   boardYDim == Board::Y_DIM && entrySize == sizeof(Entry);
+        }
+    };
+
+    size_t maxPly; // positions after at most maxPly moves are stored
+    int depth; // depth of the searches
+    std::vector<Entry> entries;
+};
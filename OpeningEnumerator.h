@@ -0,0 +1,286 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <iostream>
+#include <algorithm>
+
+#include "BlockingQueue.h"
+#include "GameRecord.h"
+#include "MyStrategy.h"
+#include "OpeningBook.h"
+
+
+// Builds an OpeningBook of all positions reachable in at most maxPly moves, up to symmetry.
+// Positions are enumerated ply by ply. Worker threads expand positions of the current ply into buffers;
+// full buffers are sorted, deduplicated and written to disk as runs, and the runs are merged into the
+// sorted file of the next ply. Then the positions of every ply are streamed to worker threads that search
+// them with the given constants (usually a fixed depth); their results are spilled as sorted runs too and
+// merged into the book file. Memory use does not depend on the number of positions.
+class OpeningEnumerator {
+public:
+    static const size_t MAX_PLIES = 32;
+
+    // memoryLimit is the total size of buffers of all threads in bytes.
+    // Temporary files are created in tempDirectory and removed when they are no longer needed.
+    OpeningEnumerator(MyConstants _constants, size_t _maxPly, size_t _threadCount, size_t _memoryLimit,
+                      std::string _tempDirectory) :
+        constants(_constants), maxPly(_maxPly < MAX_PLIES ? _maxPly : MAX_PLIES), threadCount(_threadCount == 0 ? 1 : _threadCount),
+        memoryLimit(_memoryLimit), tempDirectory(_tempDirectory), nextRun(0) {}
+
+    // Writes the book to output. Returns false if temporary files or the book can't be written.
+    bool build(const std::string& output, std::ostream& log, uint64_t& positions) {
+        std::vector<Node> initial(1, makeNode(Game(), nullptr));
+        if (!writeRecords(getLevelFileName(0), initial))
+            return false;
+
+        for (size_t ply = 0; ply < maxPly; ply++) {
+            uint64_t count;
+            if (!expand(getLevelFileName(ply), getLevelFileName(ply + 1), count))
+                return false;
+            log << "ply " << ply + 1 << ": " << count << " positions" << std::endl;
+        }
+
+        std::vector<std::string> runs;
+        bool isSearched = true;
+        for (size_t ply = 0; ply <= maxPly && isSearched; ply++) {
+            isSearched = search(getLevelFileName(ply), runs);
+            log << "ply " << ply << " searched" << std::endl;
+        }
+        for (size_t ply = 0; ply <= maxPly; ply++)
+            std::remove(getLevelFileName(ply).c_str());
+
+        // entries of all plies are merged into one sorted table, the header is rewritten when their number is known
+        FILE* file = isSearched ? fopen(output.c_str(), "wb") : nullptr;
+        bool isWritten = file && OpeningBook::writeHeader(file, maxPly, constants.MAX_DEPTH, 0) &&
+                         merge<OpeningBook::Entry>(runs, file, positions) && fseek(file, 0, SEEK_SET) == 0 &&
+                         OpeningBook::writeHeader(file, maxPly, constants.MAX_DEPTH, positions);
+        if (file && fclose(file) != 0)
+            isWritten = false;
+        for (const std::string& run : runs)
+            std::remove(run.c_str());
+        return isWritten;
+    }
+
+private:
+    // Position with one of the move sequences that lead to it
+    struct Node {
+        PositionKey key;
+        uint8_t plies;
+        uint8_t moves[MAX_PLIES];
+
+        bool operator < (const Node& other) const {
+            return key < other.key;
+        }
+    };
+
+    MyConstants constants;
+    size_t maxPly;
+    size_t threadCount;
+    size_t memoryLimit;
+    std::string tempDirectory;
+    std::atomic<size_t> nextRun;
+
+    static Node makeNode(const Game& game, const Node* parent) {
+        Node node;
+        memset(&node, 0, sizeof(node));
+        size_t symmetry;
+        node.key = PositionKey::make(game, symmetry);
+        node.plies = uint8_t(game.getMoveNumber());
+        if (parent)
+            memcpy(node.moves, parent->moves, parent->plies);
+        if (game.getMoveNumber() != 0)
+            node.moves[node.plies - 1] = GameRecord::encode(game.getMoves().back());
+        return node;
+    }
+
+    static Game replay(const Node& node) {
+        Game game;
+        for (size_t i = 0; i < node.plies; i++) {
+            Move move;
+            GameRecord::decode(node.moves[i], move);
+            game.makeMove(move);
+        }
+        return game;
+    }
+
+    std::string getLevelFileName(size_t ply) const {
+        return tempDirectory + "/othello-ply-" + std::to_string(ply) + ".tmp";
+    }
+
+    template <typename Record>
+    static bool writeRecords(const std::string& fileName, const std::vector<Record>& records) {
+        FILE* file = fopen(fileName.c_str(), "wb");
+        if (!file)
+            return false;
+        bool isWritten = fwrite(records.data(), sizeof(Record), records.size(), file) == records.size();
+        return fclose(file) == 0 && isWritten;
+    }
+
+    // Sorts and deduplicates the buffer and writes it as a new run
+    template <typename Record>
+    bool writeRun(std::vector<Record>& buffer, std::vector<std::string>& runs, std::mutex& runsMutex) {
+        std::sort(buffer.begin(), buffer.end());
+        buffer.erase(std::unique(buffer.begin(), buffer.end(), [](const Record& a, const Record& b) { return a.key == b.key; }),
+                     buffer.end());
+        std::string fileName = tempDirectory + "/othello-run-" + std::to_string(nextRun++) + ".tmp";
+        bool isWritten = writeRecords(fileName, buffer);
+        buffer.clear();
+        std::lock_guard<std::mutex> lock(runsMutex);
+        runs.push_back(fileName);
+        return isWritten;
+    }
+
+    // Sends the records of the file to the queue in chunks and closes it
+    template <typename Record>
+    static bool readChunks(const std::string& input, BlockingQueue< std::vector<Record> >& chunks) {
+        FILE* file = fopen(input.c_str(), "rb");
+        if (file) {
+            std::vector<Record> chunk(1024);
+            for (size_t size; (size = fread(chunk.data(), sizeof(Record), chunk.size(), file)) != 0; )
+                chunks.push(std::vector<Record>(chunk.begin(), chunk.begin() + size));
+            fclose(file);
+        }
+        chunks.close();
+        return file != nullptr;
+    }
+
+    bool expand(const std::string& input, const std::string& output, uint64_t& count) {
+        size_t runCapacity = std::max<size_t>(1024, memoryLimit / threadCount / sizeof(Node));
+        BlockingQueue< std::vector<Node> > chunks(threadCount * 2);
+        std::vector<std::string> runs;
+        std::mutex runsMutex;
+        std::atomic<bool> isCorrect(true);
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < threadCount; i++)
+            workers.emplace_back([&] {
+                std::vector<Node> buffer;
+                std::vector<Node> chunk;
+                while (chunks.pop(chunk))
+                    for (const Node& node : chunk) {
+                        Game game = replay(node);
+                        if (game.isGameFinished())
+                            continue;
+                        for (Move move : game.getPossibleMoves(game.getCurrentColor())) {
+                            game.makeMove(move);
+                            buffer.push_back(makeNode(game, &node));
+                            game.cancelMove();
+                            if (buffer.size() >= runCapacity && !writeRun(buffer, runs, runsMutex))
+                                isCorrect = false;
+                        }
+                    }
+                if (!buffer.empty() && !writeRun(buffer, runs, runsMutex))
+                    isCorrect = false;
+            });
+
+        if (!readChunks(input, chunks))
+            isCorrect = false;
+        for (std::thread& worker : workers)
+            worker.join();
+
+        FILE* out = isCorrect ? fopen(output.c_str(), "wb") : nullptr;
+        bool isMerged = out && merge<Node>(runs, out, count);
+        if (out && fclose(out) != 0)
+            isMerged = false;
+        for (const std::string& run : runs)
+            std::remove(run.c_str());
+        return isMerged;
+    }
+
+    // Merges sorted runs into the file dropping repeated positions
+    template <typename Record>
+    static bool merge(const std::vector<std::string>& runs, FILE* out, uint64_t& count) {
+        struct Head {
+            Record record;
+            size_t run;
+
+            bool operator < (const Head& other) const {
+                return other.record < record; // priority queue returns the largest element
+            }
+        };
+
+        std::vector<FILE*> files;
+        std::priority_queue<Head> heads;
+        for (const std::string& run : runs) {
+            files.push_back(fopen(run.c_str(), "rb"));
+            Head head;
+            head.run = files.size() - 1;
+            if (files.back() && fread(&head.record, sizeof(Record), 1, files.back()) == 1)
+                heads.push(head);
+        }
+
+        bool isCorrect = std::find(files.begin(), files.end(), nullptr) == files.end();
+        count = 0;
+        Record last = Record();
+        while (isCorrect && !heads.empty()) {
+            Head head = heads.top();
+            heads.pop();
+            if (count == 0 || !(head.record.key == last.key)) {
+                isCorrect = fwrite(&head.record, sizeof(Record), 1, out) == 1;
+                last = head.record;
+                count++;
+            }
+            if (fread(&head.record, sizeof(Record), 1, files[head.run]) == 1)
+                heads.push(head);
+        }
+
+        for (FILE* file : files)
+            if (file)
+                fclose(file);
+        return isCorrect;
+    }
+
+    // Searches all positions of the file and writes the results as sorted runs
+    bool search(const std::string& input, std::vector<std::string>& runs) {
+        size_t runCapacity = std::max<size_t>(1024, memoryLimit / threadCount / sizeof(OpeningBook::Entry));
+        BlockingQueue< std::vector<Node> > chunks(threadCount * 2);
+        std::mutex runsMutex;
+        std::atomic<bool> isCorrect(true);
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < threadCount; i++)
+            workers.emplace_back([&] {
+                MyStrategy strategy(constants);
+                std::vector<OpeningBook::Entry> buffer;
+                std::vector<Node> chunk;
+                while (chunks.pop(chunk))
+                    for (const Node& node : chunk) {
+                        buffer.push_back(searchNode(strategy, node));
+                        if (buffer.size() >= runCapacity && !writeRun(buffer, runs, runsMutex))
+                            isCorrect = false;
+                    }
+                if (!buffer.empty() && !writeRun(buffer, runs, runsMutex))
+                    isCorrect = false;
+            });
+
+        if (!readChunks(input, chunks))
+            isCorrect = false;
+        for (std::thread& worker : workers)
+            worker.join();
+        return isCorrect;
+    }
+
+    static OpeningBook::Entry searchNode(MyStrategy& strategy, const Node& node) {
+        Game game = replay(node);
+        OpeningBook::Entry entry;
+        memset(&entry, 0, sizeof(entry));
+        size_t symmetry;
+        entry.key = PositionKey::make(game, symmetry);
+        SearchResult result;
+        if (game.isGameFinished())
+            result = SearchResult(game.getScoreDifference(game.getCurrentColor()), true);
+        else
+            result = strategy.search(game);
+        entry.score = int16_t(std::max(-32767, std::min(32767, result.score)));
+        entry.move = result.move.isPass ? OpeningBook::PASS :
+                     uint8_t(BoardSymmetry::transformIndex(Board::getIndex(result.move.pos), symmetry));
+        return entry;
+    }
+};
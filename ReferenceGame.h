@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+
+#include "Game.h"
+
+
+// Straightforward implementation of the rules on a two-dimensional array, written for clarity, not speed.
+// It checks optimized Game and Board (see Verifier.h), so it must not share any logic with them.
+class ReferenceGame {
+public:
+    ReferenceGame() : passes(0), player(BLACK) {
+        for (size_t x = 0; x < Board::X_DIM; x++)
+            for (size_t y = 0; y < Board::Y_DIM; y++)
+                cells[x][y] = FREE;
+        size_t x = Board::X_DIM / 2 - 1, y = Board::Y_DIM / 2 - 1;
+        cells[x][y] = cells[x + 1][y + 1] = WHITE;
+        cells[x][y + 1] = cells[x + 1][y] = BLACK;
+    }
+
+    Color get(size_t x, size_t y) const {
+        return cells[x][y];
+    }
+
+    Color getCurrentColor() const {
+        return player;
+    }
+
+    bool isGameFinished() const {
+        return passes >= 2;
+    }
+
+    // Number of stones the move reverses, 0 if the move is illegal
+    int countFlips(size_t x, size_t y) const {
+        if (cells[x][y] != FREE)
+            return 0;
+        int count = 0;
+        for (int dx = -1; dx <= 1; dx++)
+            for (int dy = -1; dy <= 1; dy++)
+                if (dx != 0 || dy != 0)
+                    count += countFlipsInDirection(x, y, dx, dy);
+        return count;
+    }
+
+    // Legal moves in the order of field indices, pass if there are none
+    std::vector<Move> getPossibleMoves() const {
+        std::vector<Move> moves;
+        for (size_t x = 0; x < Board::X_DIM; x++)
+            for (size_t y = 0; y < Board::Y_DIM; y++)
+                if (countFlips(x, y) != 0)
+                    moves.push_back(Move(Position(x, y), false));
+        if (moves.empty())
+            moves.push_back(Move());
+        return moves;
+    }
+
+    // Returns false if the move is illegal
+    bool makeMove(Move move) {
+        std::vector<Move> moves = getPossibleMoves();
+        bool isLegal = false;
+        for (Move legal : moves)
+            isLegal |= legal == move;
+        if (!isLegal || isGameFinished())
+            return false;
+
+        if (move.isPass)
+            passes++;
+        else {
+            passes = 0;
+            size_t x = move.pos.x(), y = move.pos.y();
+            for (int dx = -1; dx <= 1; dx++)
+                for (int dy = -1; dy <= 1; dy++)
+                    if ((dx != 0 || dy != 0) && countFlipsInDirection(x, y, dx, dy) != 0)
+                        for (int cx = int(x) + dx, cy = int(y) + dy; cells[cx][cy] != player; cx += dx, cy += dy)
+                            cells[cx][cy] = player;
+            cells[x][y] = player;
+        }
+        player = player == BLACK ? WHITE : BLACK;
+        return true;
+    }
+
+    int getScore(Color color) const {
+        int count = 0;
+        for (size_t x = 0; x < Board::X_DIM; x++)
+            for (size_t y = 0; y < Board::Y_DIM; y++)
+                count += cells[x][y] == color;
+        return count;
+    }
+
+private:
+    Color cells[Board::X_DIM][Board::Y_DIM];
+    int passes; // number of passes in a row
+    Color player;
+
+    int countFlipsInDirection(size_t x, size_t y, int dx, int dy) const {
+        Color opponent = player == BLACK ? WHITE : BLACK;
+        int count = 0;
+        int cx = int(x) + dx, cy = int(y) + dy;
+        while (isInside(cx, cy) && cells[cx][cy] == opponent) {
+            cx += dx;
+            cy += dy;
+            count++;
+        }
+        if (!isInside(cx, cy) || cells[cx][cy] != player)
+            return 0;
+        return count;
+    }
+
+    static bool isInside(int x, int y) {
+        return x >= 0 && y >= 0 && x < int(Board::X_DIM) && y < int(Board::Y_DIM);
+    }
+};
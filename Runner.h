@@ -7,7 +7,8 @@
 
 class Runner {
 public:
-	Runner(Strategy* black, Strategy* white) : strategyForBlack(black), strategyForWhite(white) {}
+	Runner(std::unique_ptr<Strategy> black, std::unique_ptr<Strategy> white, const Game& initialGame=Game()) :
+	    strategyForBlack(std::move(black)), strategyForWhite(std::move(white)), game(initialGame) {}
 
 	void makeMove() {
 		if (game.getCurrentColor() == BLACK)
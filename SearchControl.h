@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+
+
+// Requests from another thread (e.g. the input thread) to the running search.
+// Search polls it in every node, so requests take effect immediately.
+class SearchControl {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    SearchControl() : isStopRequested(false), deadline(NO_DEADLINE) {}
+
+    // Stops the current search, it returns the best move found so far
+    void requestStop() {
+        isStopRequested.store(true, std::memory_order_relaxed);
+    }
+
+    // Search must finish before the time point, e.g. because the game clock runs out then
+    void setDeadline(Clock::time_point time) {
+        deadline.store(time.time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+    // Returns false if there is no deadline
+    bool getDeadline(Clock::time_point& time) const {
+        Clock::rep value = deadline.load(std::memory_order_relaxed);
+        time = Clock::time_point(Clock::duration(value));
+        return value != NO_DEADLINE;
+    }
+
+    // Called when the search finishes: requests are meant only for the search that receives them,
+    // or the next one if no search is running
+    void reset() {
+        isStopRequested.store(false, std::memory_order_relaxed);
+        deadline.store(NO_DEADLINE, std::memory_order_relaxed);
+    }
+
+    bool isStopped(Clock::time_point now) const {
+        return isStopRequested.load(std::memory_order_relaxed) ||
+               now.time_since_epoch().count() >= deadline.load(std::memory_order_relaxed);
+    }
+
+private:
+    static const Clock::rep NO_DEADLINE = std::numeric_limits<Clock::rep>::max();
+
+    std::atomic<bool> isStopRequested;
+    std::atomic<Clock::rep> deadline;
+};
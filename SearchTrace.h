@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include "GameRecord.h"
+
+
+// One searched node, written when the node returns, so children come before their parent.
+// The last node of every search is followed by a SEARCH record.
+struct TraceRecord {
+    enum Flags {
+        FINISHED = 1, // the game is over in the node
+        EVALUATED = 2, // depth limit is reached and the node is estimated statically
+        CACHED = 4, // score is taken from the endgame cache
+        SEARCH = 8, // not a node: score is the result of a search, time is its duration in microseconds
+        BOOK = 16 // depth limit is reached and the score is taken from the opening book
+    };
+    static const uint8_t NO_CUTOFF = 0xFF;
+    static const uint8_t PASS_MOVE = 0xFE;
+    static const uint8_t NO_MOVE = 0xFF; // the root of the search
+
+    int32_t alpha; // window the node was searched with
+    int32_t beta;
+    int32_t score;
+    uint32_t time; // nanoseconds spent in the static evaluation
+    uint8_t ply; // distance from the root of the search
+    int8_t depth; // remaining depth
+    uint8_t moveCount; // number of moves in the node, 0 for leaves
+    uint8_t cutoffIndex; // index of the move that caused beta cutoff, NO_CUTOFF if there was none
+    uint8_t flags;
+    uint8_t move; // move leading to the node: board index x * Y + y, PASS_MOVE or NO_MOVE
+    uint8_t reserved[2];
+
+    static uint8_t encodeMove(Move move) {
+        return move.isPass ? PASS_MOVE : uint8_t(Board::getIndex(move.pos));
+    }
+
+    static Move decodeMove(uint8_t move) {
+        return move == PASS_MOVE ? Move() : Move(Position(move / Board::Y_DIM, move % Board::Y_DIM), false);
+    }
+};
+
+
+// Binary trace file shared by several searches, possibly in different threads.
+// Records are appended in chunks; after maxRecords records the rest is dropped, so tracing a long run
+// can't fill the disk.
+class TraceFile {
+public:
+    ~TraceFile() {
+        if (file)
+            fclose(file);
+    }
+
+    // Returns nullptr if the file can't be created. maxRecords = 0 means no limit.
+    static std::shared_ptr<TraceFile> create(const std::string& path, uint64_t maxRecords=0) {
+        std::shared_ptr<TraceFile> trace(new TraceFile());
+        trace->file = fopen(path.c_str(), "wb");
+        if (!trace->file)
+            return nullptr;
+        // records are buffered by SearchTracer, stdio must not allocate its own buffer during search
+        setvbuf(trace->file, nullptr, _IONBF, 0);
+        trace->maxRecords = maxRecords;
+        Header header = Header::make();
+        fwrite(&header, sizeof(header), 1, trace->file);
+        return trace;
+    }
+
+    void write(const TraceRecord* records, size_t count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (maxRecords != 0)
+            count = size_t(std::min<uint64_t>(count, maxRecords - std::min(maxRecords, recordCount)));
+        if (count != 0 && fwrite(records, sizeof(TraceRecord), count, file) == count)
+            recordCount += count;
+    }
+
+    // Reads all records, returns false if the file is not a trace
+    static bool read(const std::string& path, std::vector<TraceRecord>& records) {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file)
+            return false;
+        Header header;
+        bool isCorrect = fread(&header, sizeof(header), 1, file) == 1 && header.isCompatible();
+        TraceRecord record;
+        while (isCorrect && fread(&record, sizeof(record), 1, file) == 1)
+            records.push_back(record);
+        fclose(file);
+        return isCorrect;
+    }
+
+private:
+    struct Header {
+        static const uint32_t VERSION = 2;
+
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize;
+
+        static Header make() {
+            Header header;
+            memcpy(header.magic, "OTHTRACE", 8);
+            header.version = VERSION;
+            header.recordSize = sizeof(TraceRecord);
+            return header;
+        }
+
+        bool isCompatible() const {
+            return memcmp(magic, "OTHTRACE", 8) == 0 && version == VERSION && recordSize == sizeof(TraceRecord);
+        }
+    };
+
+    FILE* file = nullptr;
+    std::mutex mutex;
+    uint64_t maxRecords = 0;
+    uint64_t recordCount = 0;
+
+    TraceFile() {}
+};
+
+
+// Collects records of one search thread in a fixed buffer and writes them to the trace file when it is full,
+// so tracing costs a copy of 24 bytes per node and does not allocate memory during search.
+class SearchTracer {
+public:
+    explicit SearchTracer(std::shared_ptr<TraceFile> _file, size_t capacity=1 << 14) :
+        file(_file), records(capacity), count(0) {}
+
+    ~SearchTracer() {
+        flush();
+    }
+
+    void add(const TraceRecord& record) {
+        records[count++] = record;
+        if (count == records.size())
+            flush();
+    }
+
+    void flush() {
+        file->write(records.data(), count);
+        count = 0;
+    }
+
+private:
+    std::shared_ptr<TraceFile> file;
+    std::vector<TraceRecord> records;
+    size_t count;
+};
+
+
+// Statistics of a trace by ply: number of nodes, branching factor (number of moves in interior nodes),
+// share of interior nodes with a beta cutoff, share of cutoffs made by the first move, average index of
+// the cutoff move, and share of the search time spent in the static evaluation.
+// Good move ordering makes first move cutoffs close to 100% and the average cutoff index close to 0.
+// Then root moves of the last iteration of the last search are listed with their windows, scores and
+// subtree sizes; subtrees are complete if the trace was written by one thread.
+inline void printTraceSummary(const std::vector<TraceRecord>& records, std::ostream& out) {
+    struct PlyStatistics {
+        uint64_t nodes = 0, interiorNodes = 0, moves = 0, cutoffs = 0, firstMoveCutoffs = 0, cutoffIndexSum = 0;
+        uint64_t leaves = 0, evaluations = 0, evaluationTime = 0;
+    };
+    struct RootMove {
+        const TraceRecord* record;
+        uint64_t nodes;
+    };
+    std::vector<PlyStatistics> plies;
+    uint64_t searches = 0, searchTime = 0, evaluationTime = 0;
+    // children come before their parent, so the subtree of a root move is everything since the previous one
+    std::vector<RootMove> iteration, lastIteration;
+    uint64_t subtreeNodes = 0;
+
+    for (const TraceRecord& record : records) {
+        if (record.flags & TraceRecord::SEARCH) {
+            searches++;
+            searchTime += uint64_t(record.time) * 1000;
+            if (!iteration.empty())
+                lastIteration.swap(iteration);
+            iteration.clear();
+            subtreeNodes = 0;
+            continue;
+        }
+        subtreeNodes++;
+        if (record.ply == 0)
+            subtreeNodes = 0;
+        else if (record.ply == 1) {
+            // root moves of the next iteration are searched one ply deeper
+            if (!iteration.empty() && iteration.back().record->depth != record.depth)
+                iteration.clear();
+            iteration.push_back({&record, subtreeNodes});
+            subtreeNodes = 0;
+        }
+        if (plies.size() <= record.ply)
+            plies.resize(record.ply + 1);
+        PlyStatistics& ply = plies[record.ply];
+        ply.nodes++;
+        if (record.moveCount == 0) {
+            ply.leaves++;
+            if (record.flags & TraceRecord::EVALUATED) {
+                ply.evaluations++;
+                ply.evaluationTime += record.time;
+                evaluationTime += record.time;
+            }
+            continue;
+        }
+        ply.interiorNodes++;
+        ply.moves += record.moveCount;
+        if (record.cutoffIndex != TraceRecord::NO_CUTOFF) {
+            ply.cutoffs++;
+            ply.firstMoveCutoffs += record.cutoffIndex == 0;
+            ply.cutoffIndexSum += record.cutoffIndex;
+        }
+    }
+
+    auto ratio = [](double a, double b) { return b == 0 ? 0.0 : a / b; };
+    out << "searches: " << searches << ", nodes: " << records.size() - searches << '\n';
+    out << std::setw(4) << "ply" << std::setw(12) << "nodes" << std::setw(10) << "leaves" << std::setw(10) << "branching" <<
+           std::setw(10) << "cutoffs" << std::setw(10) << "first" << std::setw(10) << "index" <<
+           std::setw(12) << "eval ns" << '\n';
+    out << std::fixed << std::setprecision(2);
+    for (size_t i = 0; i < plies.size(); i++) {
+        const PlyStatistics& ply = plies[i];
+        out << std::setw(4) << i << std::setw(12) << ply.nodes << std::setw(10) << ply.leaves <<
+               std::setw(10) << ratio(ply.moves, ply.interiorNodes) <<
+               std::setw(9) << 100 * ratio(ply.cutoffs, ply.interiorNodes) << '%' <<
+               std::setw(9) << 100 * ratio(ply.firstMoveCutoffs, ply.cutoffs) << '%' <<
+               std::setw(10) << ratio(ply.cutoffIndexSum, ply.cutoffs) <<
+               std::setw(12) << ratio(ply.evaluationTime, ply.evaluations) << '\n';
+    }
+    out << "evaluation time: " << 100 * ratio(evaluationTime, searchTime) << "% of " << searchTime / 1e9 << " s\n";
+
+    if (lastIteration.empty())
+        return;
+    out << "root moves of the last search:\n";
+    out << std::setw(6) << "move" << std::setw(6) << "depth" << std::setw(10) << "alpha" << std::setw(10) << "beta" <<
+           std::setw(10) << "score" << std::setw(12) << "nodes" << '\n';
+    for (const RootMove& rootMove : lastIteration) {
+        const TraceRecord& record = *rootMove.record;
+        std::string move = record.move == TraceRecord::NO_MOVE ? "-" : moveToString(TraceRecord::decodeMove(record.move));
+        out << std::setw(6) << move << std::setw(6) << int(record.depth) << std::setw(10) << record.alpha <<
+               std::setw(10) << record.beta << std::setw(10) << record.score << std::setw(12) << rootMove.nodes << '\n';
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+
+// Bounded lock-free queue for one producer thread and one consumer thread.
+// push and tryPop never block on a lock. waitPop sleeps while the queue is empty; the producer takes
+// the lock to wake it only when the consumer is actually sleeping.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) : items(capacity + 1), head(0), tail(0), closed(false), isWaiting(false) {}
+
+    // Called only by the producer. Spins while the queue is full.
+    void push(T value) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        size_t nextTail = next(currentTail);
+        while (nextTail == head.load(std::memory_order_acquire))
+            std::this_thread::yield();
+        items[currentTail] = std::move(value);
+        // sequentially consistent, so that either the consumer sees the item or wakeConsumer sees it waiting
+        tail.store(nextTail, std::memory_order_seq_cst);
+        wakeConsumer();
+    }
+
+    // Called only by the producer. After it waitPop returns false once the queue is empty.
+    void close() {
+        closed.store(true, std::memory_order_seq_cst);
+        wakeConsumer();
+    }
+
+    // Called only by the consumer. Returns false if the queue is empty.
+    bool tryPop(T& value) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire))
+            return false;
+        value = std::move(items[currentHead]);
+        head.store(next(currentHead), std::memory_order_release);
+        return true;
+    }
+
+    // Called only by the consumer. Returns false when the queue is closed and there are no items left.
+    bool waitPop(T& value) {
+        while (!tryPop(value)) {
+            if (closed.load(std::memory_order_acquire))
+                return tryPop(value);
+            std::unique_lock<std::mutex> lock(mutex);
+            isWaiting.store(true, std::memory_order_seq_cst);
+            // the producer may have pushed before it could see isWaiting
+            if (head.load(std::memory_order_relaxed) == tail.load(std::memory_order_seq_cst) &&
+                !closed.load(std::memory_order_seq_cst))
+                nonEmpty.wait(lock);
+            isWaiting.store(false, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+private:
+    std::vector<T> items;
+    std::atomic<size_t> head; // next item to pop, written by the consumer
+    std::atomic<size_t> tail; // next free slot, written by the producer
+    std::atomic<bool> closed;
+    std::atomic<bool> isWaiting;
+    std::mutex mutex;
+    std::condition_variable nonEmpty;
+
+    size_t next(size_t index) const {
+        return index + 1 == items.size() ? 0 : index + 1;
+    }
+
+    void wakeConsumer() {
+        if (isWaiting.load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            nonEmpty.notify_one();
+        }
+    }
+};
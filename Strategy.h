@@ -2,7 +2,11 @@
 
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
+#include <cctype>
+#include <cstdlib>
 
+#include "AsyncInput.h"
 #include "Game.h"
 
 class Strategy {
@@ -11,9 +15,21 @@ public:
 	virtual ~Strategy() = default;
 };
 
+// Reads a move written as column letter and row number, e.g. "b5" or "b 5"
+inline bool parseMoveMessage(const ProtocolMessage& message, Move& move) {
+	std::string text = message.command;
+	for (const std::string& argument : message.arguments)
+		text += argument;
+	if (text.size() < 2 || !isalpha(text[0]) || !isdigit(text[1]))
+		return false;
+	move = Move(Position(atoi(text.c_str() + 1) - 1, tolower(text[0]) - 'a'), false);
+	return true;
+}
+
+// Human player. Output is flushed only before waiting for the input.
 class StreamStrategy : public Strategy {
 public:
-	StreamStrategy (std::istream& _in, std::ostream& _out) : in(_in), out(_out) {}
+	StreamStrategy (AsyncInput& _in, std::ostream& _out) : in(_in), out(_out) {}
 
 	Move makeMove(const Game& game) override {
 		if (game.getMoveNumber() != 0) {
@@ -21,63 +37,68 @@ public:
                 out << "Pass\n";
             else
                 out << char(game.getMoves().back().pos.y() + 'a') << ' ' <<
-                            game.getMoves().back().pos.x() + 1 << std::endl;
-            out.flush();
+                            game.getMoves().back().pos.x() + 1 << '\n';
 		}
+		out.flush();
 
-        int x;
-        char y;
-        in >> y >> x;
-        return Move(Position(x - 1, y - 'a'), false);
+        ProtocolMessage message;
+        Move move;
+        do {
+            if (!in.read(message))
+                throw std::runtime_error("input is closed");
+        } while (!parseMoveMessage(message, move));
+        return move;
 	}
 
 private:
-	std::istream& in;
+	AsyncInput& in;
 	std::ostream& out;
 };
 
+// Opponent on the game server. Output is flushed only before waiting for the input.
 class ServerStrategy : public Strategy {
 public:
-	ServerStrategy (std::istream& _in, std::ostream& _out) : in(_in), out(_out) {}
+	ServerStrategy (AsyncInput& _in, std::ostream& _out) : in(_in), out(_out) {}
 
 	Move makeMove(const Game& game) override {
 		if (game.getMoveNumber() != 0) {
-		    std::string s;
-		    in >> s;
+		    ProtocolMessage message = read();
 
-		    if (s == "turn") {
+		    if (message.command == "turn") {
                 out << "move " <<
                        char(game.getMoves().back().pos.y() + 'a') << ' ' <<
-                            game.getMoves().back().pos.x() + 1 << std::endl;
-                out.flush();
+                            game.getMoves().back().pos.x() + 1 << '\n';
             }
 		}
 
-        std::vector<Move> moves = game.getPossibleMoves(game.getCurrentColor());
+        MoveList moves = game.getPossibleMoves(game.getCurrentColor());
         if (moves.size() == 1 && moves[0].isPass)
             return moves[0];
 
-        std::string s;
-        in >> s;
-        if (s == "move") {
-            int x;
-            char y;
-            in >> y >> x;
-
-            return Move(Position(x - 1, y - 'a'), false);
-        }
+        ProtocolMessage message = read();
+        Move move;
+        if (message.command == "move" && parseMoveMessage(ProtocolMessage{"", message.arguments}, move))
+            return move;
         else
             return moves[0];
 	}
 
 private:
-	std::istream& in;
+	AsyncInput& in;
 	std::ostream& out;
+
+	ProtocolMessage read() {
+	    out.flush();
+	    ProtocolMessage message;
+	    if (!in.read(message))
+	        throw std::runtime_error("input is closed");
+	    return message;
+	}
 };
 
 class RandomStrategy : public Strategy {
 	Move makeMove(const Game& game) override {
-		std::vector<Move> moves = game.getPossibleMoves(game.getCurrentColor());
+		MoveList moves = game.getPossibleMoves(game.getCurrentColor());
 		return moves[rand() % moves.size()];
 	}
 };
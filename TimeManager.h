@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+
+#include "Game.h"
+
+
+// Splits the clock of the whole game between moves.
+// Forced moves take no time. A share of the total time is kept for the endgame, where the search can solve
+// the position exactly. The rest is spread over the moves before the endgame: midgame moves get more than
+// opening moves, and positions with many legal moves get more than positions with few.
+class TimeManager {
+public:
+    // Times are in seconds. increment is added to the clock after every own move.
+    TimeManager(double totalTime, double _increment, double _endgameShare=0.3, size_t _endgameEmpties=16) :
+        timeLeft(totalTime), increment(_increment), endgameReserve(totalTime * _endgameShare),
+        endgameEmpties(_endgameEmpties) {}
+
+    // Thinking time for the player to move in the position, 0 if and only if the move is forced.
+    // When the clock is exhausted the time is MIN_TIME, so that a quick search still chooses the move.
+    double allocate(const Game& game) const {
+        Color player = game.getCurrentColor();
+        MoveList moves = game.getPossibleMoves(player);
+        if (moves.size() == 1)
+            return 0;
+
+        size_t empties = game.getAmountOfFreePositions();
+        double available = timeLeft - SAFETY_MARGIN;
+        double time;
+        if (empties <= endgameEmpties) {
+            // the first moves of the endgame are the hardest to solve
+            double ownMoves = std::max<double>(1, (empties + 1) / 2);
+            time = 2 * (available + increment * (ownMoves - 1)) / (ownMoves + 1);
+        } else {
+            // own moves left before the endgame, weighted by their phase
+            size_t plies = empties - endgameEmpties;
+            size_t openingPlies = game.getMoveNumber() < OPENING_PLIES ?
+                                  std::min(plies, OPENING_PLIES - game.getMoveNumber()) : 0;
+            double weights = std::max(1.0, (OPENING_WEIGHT * openingPlies + MIDDLEGAME_WEIGHT * (plies - openingPlies)) / 2);
+            double phase = openingPlies != 0 ? OPENING_WEIGHT : MIDDLEGAME_WEIGHT;
+            double complexity = std::min(1.5, std::max(0.5, moves.size() / 10.0));
+            double budget = std::max(0.0, available - std::min(endgameReserve, available / 2));
+            time = (budget / weights + increment) * phase * complexity;
+        }
+        // never risk the rest of the clock on one move
+        time = std::min(time, available / 2);
+        return time > MIN_TIME ? time : MIN_TIME;
+    }
+
+    // Called after every own move with the time it took
+    void finishMove(double time) {
+        timeLeft += increment - time;
+    }
+
+    // Corrects the clock, e.g. by the time left reported by the server
+    void setTimeLeft(double time) {
+        timeLeft = time;
+    }
+
+    double getTimeLeft() const {
+        return timeLeft;
+    }
+
+private:
+    static constexpr double SAFETY_MARGIN = 0.05; // for communication and the moves of the search that are not timed
+    static constexpr double MIN_TIME = 0.01; // enough for the first iterations
+    static const size_t OPENING_PLIES = (Board::SIZE - 4) / 3; // the same as MyEstimator uses, 20 on 8x8
+    static constexpr double OPENING_WEIGHT = 0.6;
+    static constexpr double MIDDLEGAME_WEIGHT = 1.3;
+
+    double timeLeft;
+    double increment;
+    double endgameReserve;
+    size_t endgameEmpties;
+};
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <cmath>
+#include <cstdlib>
+
+#include "BlockingQueue.h"
+#include "GameRecord.h"
+#include "MyStrategy.h"
+#include "Runner.h"
+
+
+struct EngineConfig {
+    EngineConfig(std::string _name, MyConstants _constants) : name(_name), constants(_constants) {}
+
+    // Parses "name=cornerCost,XFieldCost,CFieldCost,timeInMilliseconds[,maxDepth[,maxNodes]][@weightsFile]"
+    static bool parse(const std::string& text, std::vector<EngineConfig>& configs) {
+        size_t separator = text.find('=');
+        if (separator == std::string::npos || separator == 0)
+            return false;
+
+        size_t weightsSeparator = text.find('@', separator);
+        std::shared_ptr<const EvaluationWeights> weights;
+        if (weightsSeparator != std::string::npos) {
+            weights = EvaluationWeights::load(text.substr(weightsSeparator + 1));
+            if (!weights)
+                return false;
+        }
+
+        std::vector<long long> values;
+        std::istringstream stream(text.substr(separator + 1, weightsSeparator - separator - 1));
+        std::string value;
+        while (std::getline(stream, value, ',')) {
+            char* end;
+            values.push_back(strtoll(value.c_str(), &end, 10));
+            if (value.empty() || *end != '\0')
+                return false;
+        }
+        if (values.size() < 4 || values.size() > 6)
+            return false;
+        values.resize(6, 0);
+
+        configs.emplace_back(text.substr(0, separator), MyConstants(int(values[0]), int(values[1]), int(values[2]),
+                             values[3] / 1000.0, int(values[4]), uint64_t(values[5]), weights));
+        return true;
+    }
+
+    std::string name;
+    MyConstants constants;
+};
+
+
+// Wins, draws and losses of one engine against another engine or against the whole field.
+struct MatchScore {
+    MatchScore() : wins(0), draws(0), losses(0) {}
+
+    void add(int scoreDifference) {
+        if (scoreDifference > 0)
+            wins++;
+        else if (scoreDifference < 0)
+            losses++;
+        else
+            draws++;
+    }
+
+    size_t games() const {
+        return wins + draws + losses;
+    }
+
+    double points() const {
+        return wins + 0.5 * draws;
+    }
+
+    // Elo difference implied by the score and half-width of its 95% confidence interval
+    void elo(double& difference, double& error) const {
+        double n = games();
+        if (n == 0) {
+            difference = error = 0;
+            return;
+        }
+        double mean = points() / n;
+        double deviation = std::sqrt(std::max(0.0, (wins + 0.25 * draws) / n - mean * mean));
+        double margin = 1.96 * deviation / std::sqrt(n);
+        difference = toElo(mean);
+        error = (toElo(mean + margin) - toElo(mean - margin)) / 2;
+    }
+
+    size_t wins;
+    size_t draws;
+    size_t losses;
+
+private:
+    static double toElo(double score) {
+        score = std::min(std::max(score, 0.001), 0.999);
+        return -400 * std::log10(1 / score - 1);
+    }
+};
+
+
+// Plays games between several engine configurations on a pool of worker threads.
+// Every pairing plays each opening twice with colours swapped.
+class Tournament {
+public:
+    enum Schedule { ROUND_ROBIN, GAUNTLET }; // GAUNTLET: the first engine plays against all others
+
+    Tournament(std::vector<EngineConfig> _engines, Schedule _schedule, std::vector<Game> _openings, size_t _threadCount) :
+        engines(_engines), schedule(_schedule), openings(_openings), threadCount(_threadCount == 0 ? 1 : _threadCount),
+        scores(_engines.size(), std::vector<MatchScore>(_engines.size())) {}
+
+    // Unique positions after given number of plies, whose static estimation
+    // is at most maxImbalance for the player to move.
+    static std::vector<Game> generateOpenings(size_t plies, int maxImbalance) {
+        std::vector<Game> openings;
+        std::unordered_set<Board, BoardHasher> visited;
+        Game game;
+        collectOpenings(game, plies, visited, openings);
+
+        MyEstimator estimator(10, -5, -2);
+        std::vector<Game> balanced;
+        for (const Game& opening : openings)
+            if (std::abs(estimator.estimate(opening, opening.getCurrentColor())) <= maxImbalance)
+                balanced.push_back(opening);
+        return balanced;
+    }
+
+    // Plays all games. If records is not null, every game is written to it in a PGN-like text format.
+    void run(std::ostream* records, std::ostream& log) {
+        BlockingQueue<Pairing> pairings(threadCount * 4);
+        std::mutex resultsMutex;
+        size_t finishedGames = 0;
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < threadCount; i++)
+            workers.emplace_back([&] {
+                Pairing pairing;
+                while (pairings.pop(pairing)) {
+                    Runner runner(std::make_unique<MyStrategy>(engines[pairing.black].constants),
+                                  std::make_unique<MyStrategy>(engines[pairing.white].constants),
+                                  openings[pairing.opening]);
+                    runner.run();
+                    int difference = runner.getGame().getScoreDifference(BLACK);
+
+                    std::lock_guard<std::mutex> lock(resultsMutex);
+                    scores[pairing.black][pairing.white].add(difference);
+                    scores[pairing.white][pairing.black].add(-difference);
+                    if (records)
+                        writeRecord(*records, pairing, runner.getGame());
+                    log << "game " << ++finishedGames << ": " << engines[pairing.black].name << ' ' <<
+                           runner.getGame().getScore(BLACK) << '-' << runner.getGame().getScore(WHITE) << ' ' <<
+                           engines[pairing.white].name << '\n';
+                }
+            });
+
+        size_t round = 0;
+        for (size_t first = 0; first < engines.size(); first++)
+            for (size_t second = first + 1; second < engines.size(); second++) {
+                if (schedule == GAUNTLET && first != 0)
+                    continue;
+                for (size_t opening = 0; opening < openings.size(); opening++) {
+                    pairings.push(Pairing(round++, first, second, opening));
+                    pairings.push(Pairing(round++, second, first, opening));
+                }
+            }
+        pairings.close();
+
+        for (std::thread& worker : workers)
+            worker.join();
+        log.flush();
+    }
+
+    void printResults(std::ostream& out) const {
+        out << std::left << std::setw(16) << "engine" << std::right << std::setw(8) << "games" <<
+               std::setw(7) << "+" << std::setw(7) << "=" << std::setw(7) << "-" <<
+               std::setw(9) << "score" << std::setw(16) << "elo" << '\n';
+        for (size_t i = 0; i < engines.size(); i++) {
+            MatchScore total;
+            for (size_t j = 0; j < engines.size(); j++) {
+                total.wins += scores[i][j].wins;
+                total.draws += scores[i][j].draws;
+                total.losses += scores[i][j].losses;
+            }
+            printLine(out, engines[i].name, total);
+        }
+
+        out << '\n';
+        for (size_t i = 0; i < engines.size(); i++)
+            for (size_t j = i + 1; j < engines.size(); j++)
+                if (scores[i][j].games() != 0)
+                    printLine(out, engines[i].name + " vs " + engines[j].name, scores[i][j]);
+    }
+
+private:
+    struct Pairing {
+        Pairing() {}
+        Pairing(size_t _round, size_t _black, size_t _white, size_t _opening) :
+            round(_round), black(_black), white(_white), opening(_opening) {}
+
+        size_t round;
+        size_t black;
+        size_t white;
+        size_t opening;
+    };
+
+    std::vector<EngineConfig> engines;
+    Schedule schedule;
+    std::vector<Game> openings;
+    size_t threadCount;
+    std::vector< std::vector<MatchScore> > scores; // scores[i][j] - results of engine i against engine j
+
+    static void collectOpenings(Game& game, size_t plies, std::unordered_set<Board, BoardHasher>& visited,
+                                std::vector<Game>& openings) {
+        if (game.isGameFinished())
+            return;
+        if (game.getMoveNumber() == plies) {
+            if (visited.insert(game.getBoard()).second)
+                openings.push_back(game);
+            return;
+        }
+        for (Move move : game.getPossibleMoves(game.getCurrentColor())) {
+            game.makeMove(move);
+            collectOpenings(game, plies, visited, openings);
+            game.cancelMove();
+        }
+    }
+
+    void writeRecord(std::ostream& out, const Pairing& pairing, const Game& game) const {
+        const Game& opening = openings[pairing.opening];
+        out << "[Round \"" << pairing.round + 1 << "\"]\n";
+        out << "[Black \"" << engines[pairing.black].name << "\"]\n";
+        out << "[White \"" << engines[pairing.white].name << "\"]\n";
+        out << "[Opening \"";
+        for (size_t i = 0; i < opening.getMoveNumber(); i++)
+            out << moveToString(opening.getMoves()[i]);
+        out << "\"]\n";
+        out << "[Result \"" << game.getScore(BLACK) << '-' << game.getScore(WHITE) << "\"]\n";
+        for (size_t i = 0; i < game.getMoveNumber(); i++)
+            out << (i == 0 ? "" : " ") << moveToString(game.getMoves()[i]);
+        out << "\n\n";
+    }
+
+    static void printLine(std::ostream& out, const std::string& name, const MatchScore& score) {
+        double elo, error;
+        score.elo(elo, error);
+        std::ostringstream eloText;
+        eloText << std::fixed << std::setprecision(0) << std::showpos << elo << std::noshowpos << " +- " << error;
+        out << std::left << std::setw(16) << name << std::right << std::setw(8) << score.games() <<
+               std::setw(7) << score.wins << std::setw(7) << score.draws << std::setw(7) << score.losses <<
+               std::setw(8) << std::fixed << std::setprecision(1) << 100 * score.points() / std::max<size_t>(1, score.games()) << '%' <<
+               std::setw(16) << eloText.str() << '\n';
+    }
+};
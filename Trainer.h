@@ -0,0 +1,188 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cmath>
+
+#include "MyStrategy.h"
+
+
+struct TrainingSample {
+    size_t stage;
+    int features[EvaluationWeights::FEATURE_COUNT];
+    int label; // final score difference for the player to move
+};
+
+
+// Fits EvaluationWeights to positions from self-play games.
+// Games start with a few random moves, then are played by fixed depth search, and the last
+// exactEmpties moves are played by the exact solver. Every position is labeled with the final
+// score difference, which is exact for the endgame positions.
+// Weights of every stage are found by least squares with a small ridge regularization.
+class Trainer {
+public:
+    Trainer(MyConstants _constants, size_t _exactEmpties, size_t _randomPlies, size_t _threadCount) :
+        constants(_constants), exactEmpties(_exactEmpties), randomPlies(_randomPlies),
+        threadCount(_threadCount == 0 ? 1 : _threadCount) {}
+
+    void generate(size_t gameCount, std::ostream& log) {
+        std::atomic<size_t> nextGame(0);
+        std::mutex samplesMutex;
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < threadCount; i++)
+            workers.emplace_back([&] {
+                MyStrategy strategy(constants);
+                std::vector<TrainingSample> gameSamples;
+                for (size_t game = nextGame++; game < gameCount; game = nextGame++) {
+                    playGame(strategy, game, gameSamples);
+
+                    std::lock_guard<std::mutex> lock(samplesMutex);
+                    samples.insert(samples.end(), gameSamples.begin(), gameSamples.end());
+                    if ((game + 1) % 100 == 0)
+                        log << game + 1 << " games, " << samples.size() << " positions" << std::endl;
+                }
+            });
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    EvaluationWeights fit(double regularization, std::ostream& log) const {
+        const size_t F = EvaluationWeights::FEATURE_COUNT;
+        const size_t stageCount = EvaluationWeights::getStageCount();
+
+        // normal equations (X^T X + regularization * I) w = X^T y for every stage,
+        // every thread accumulates its own share of samples
+        std::vector< std::vector<double> > partialSums(threadCount);
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threadCount; t++)
+            workers.emplace_back([&, t] {
+                std::vector<double>& sums = partialSums[t];
+                sums.assign(stageCount * (F * F + F + 1), 0.0);
+                for (size_t i = t; i < samples.size(); i += threadCount) {
+                    const TrainingSample& sample = samples[i];
+                    double* stageSums = &sums[sample.stage * (F * F + F + 1)];
+                    for (size_t a = 0; a < F; a++) {
+                        for (size_t b = 0; b < F; b++)
+                            stageSums[a * F + b] += double(sample.features[a]) * sample.features[b];
+                        stageSums[F * F + a] += double(sample.features[a]) * sample.label;
+                    }
+                    stageSums[F * F + F] += 1;
+                }
+            });
+        for (std::thread& worker : workers)
+            worker.join();
+
+        EvaluationWeights weights;
+        for (size_t stage = 0; stage < stageCount; stage++) {
+            std::vector<double> matrix(F * (F + 1), 0.0);
+            double count = 0;
+            for (const std::vector<double>& sums : partialSums) {
+                const double* stageSums = &sums[stage * (F * F + F + 1)];
+                for (size_t a = 0; a < F; a++) {
+                    for (size_t b = 0; b < F; b++)
+                        matrix[a * (F + 1) + b] += stageSums[a * F + b];
+                    matrix[a * (F + 1) + F] += stageSums[F * F + a];
+                }
+                count += stageSums[F * F + F];
+            }
+            for (size_t a = 0; a < F; a++)
+                matrix[a * (F + 1) + a] += regularization * std::max(1.0, count);
+
+            std::vector<double> solution = solveLinearSystem(matrix, F);
+            for (size_t i = 0; i < F; i++)
+                weights.at(stage, i) = solution[i];
+            log << "stage " << stage << ": " << size_t(count) << " positions, rmse " <<
+                   rootMeanSquareError(weights, stage) << std::endl;
+        }
+        return weights;
+    }
+
+    size_t getSampleCount() const {
+        return samples.size();
+    }
+
+private:
+    MyConstants constants;
+    size_t exactEmpties;
+    size_t randomPlies;
+    size_t threadCount;
+    std::vector<TrainingSample> samples;
+
+    void playGame(MyStrategy& strategy, size_t seed, std::vector<TrainingSample>& gameSamples) const {
+        std::mt19937 random(seed);
+        std::vector<Color> players;
+        Game game;
+        gameSamples.clear();
+
+        while (!game.isGameFinished()) {
+            TrainingSample sample;
+            sample.stage = EvaluationWeights::getStage(game);
+            EvaluationWeights::getFeatures(game, game.getCurrentColor(), sample.features);
+            gameSamples.push_back(sample);
+            players.push_back(game.getCurrentColor());
+
+            Move move;
+            if (game.getAmountOfFreePositions() <= exactEmpties)
+                move = strategy.solve(game).move;
+            else if (game.getMoveNumber() < randomPlies) {
+                MoveList moves = game.getPossibleMoves(game.getCurrentColor());
+                move = moves[random() % moves.size()];
+            } else
+                move = strategy.search(game).move;
+            game.makeMove(move);
+        }
+
+        for (size_t i = 0; i < gameSamples.size(); i++)
+            gameSamples[i].label = game.getScoreDifference(players[i]);
+    }
+
+    // Gaussian elimination with partial pivoting, matrix is n x (n + 1) augmented matrix
+    static std::vector<double> solveLinearSystem(std::vector<double> matrix, size_t n) {
+        for (size_t column = 0; column < n; column++) {
+            size_t pivot = column;
+            for (size_t row = column + 1; row < n; row++)
+                if (std::abs(matrix[row * (n + 1) + column]) > std::abs(matrix[pivot * (n + 1) + column]))
+                    pivot = row;
+            for (size_t i = 0; i <= n; i++)
+                std::swap(matrix[column * (n + 1) + i], matrix[pivot * (n + 1) + i]);
+            double value = matrix[column * (n + 1) + column];
+            if (std::abs(value) < 1e-12)
+                continue;
+            for (size_t row = 0; row < n; row++) {
+                if (row == column)
+                    continue;
+                double factor = matrix[row * (n + 1) + column] / value;
+                for (size_t i = column; i <= n; i++)
+                    matrix[row * (n + 1) + i] -= factor * matrix[column * (n + 1) + i];
+            }
+        }
+
+        std::vector<double> solution(n, 0.0);
+        for (size_t i = 0; i < n; i++) {
+            double value = matrix[i * (n + 1) + i];
+            if (std::abs(value) >= 1e-12)
+                solution[i] = matrix[i * (n + 1) + n] / value;
+        }
+        return solution;
+    }
+
+    double rootMeanSquareError(const EvaluationWeights& weights, size_t stage) const {
+        double sum = 0;
+        size_t count = 0;
+        for (const TrainingSample& sample : samples) {
+            if (sample.stage != stage)
+                continue;
+            double prediction = 0;
+            for (size_t i = 0; i < EvaluationWeights::FEATURE_COUNT; i++)
+                prediction += weights.at(stage, i) * sample.features[i];
+            sum += (prediction - sample.label) * (prediction - sample.label);
+            count++;
+        }
+        return count == 0 ? 0 : std::sqrt(sum / count);
+    }
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+#include "Game.h"
+#include "GameRecord.h"
+#include "ReferenceGame.h"
+
+
+// Checks move generation, make/unmake and hashing of Game against ReferenceGame.
+class Verifier {
+public:
+    // Number of positions after depth plies. Pass is a ply, finished games are counted as positions.
+    static uint64_t perft(Game& game, int depth) {
+        if (depth == 0 || game.isGameFinished())
+            return 1;
+        uint64_t count = 0;
+        for (Move move : game.getPossibleMoves(game.getCurrentColor())) {
+            game.makeMove(move);
+            count += perft(game, depth - 1);
+            game.cancelMove();
+        }
+        return count;
+    }
+
+    static uint64_t perft(const ReferenceGame& game, int depth) {
+        if (depth == 0 || game.isGameFinished())
+            return 1;
+        uint64_t count = 0;
+        for (Move move : game.getPossibleMoves()) {
+            ReferenceGame child = game;
+            child.makeMove(move);
+            count += perft(child, depth - 1);
+        }
+        return count;
+    }
+
+    // Known perft values of the standard board for depths from 1, 0 for other boards
+    static uint64_t getKnownPerft(int depth) {
+        static const uint64_t known[] = {4, 12, 56, 244, 1396, 8200, 55092, 390216, 3005288, 24571284};
+        if (Board::X_DIM != 8 || Board::Y_DIM != 8 || depth < 1 || depth > 10)
+            return 0;
+        return known[depth - 1];
+    }
+
+    // Plays random games and compares Game with ReferenceGame in every position: the board, legal moves,
+    // the result of every legal and illegal move, and the board and hash after the move is cancelled.
+    // Returns number of positions with differences, the first of them are described in err.
+    static uint64_t fuzz(size_t gameCount, uint64_t seed, size_t threadCount, std::ostream& err, uint64_t& positions) {
+        std::atomic<size_t> nextGame(0);
+        std::atomic<uint64_t> errors(0);
+        std::atomic<uint64_t> checkedPositions(0);
+        std::mutex errMutex;
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < std::max<size_t>(threadCount, 1); i++)
+            workers.emplace_back([&] {
+                for (size_t index = nextGame++; index < gameCount; index = nextGame++) {
+                    std::mt19937_64 random(seed + index);
+                    Game game;
+                    ReferenceGame reference;
+                    while (true) {
+                        checkedPositions++;
+                        std::string error = checkPosition(game, reference);
+                        if (!error.empty()) {
+                            if (errors++ < MAX_REPORTED_ERRORS) {
+                                std::lock_guard<std::mutex> lock(errMutex);
+                                err << "game " << index << " (seed " << seed + index << "), moves " << getMoves(game) <<
+                                       ": " << error << '\n';
+                            }
+                            break;
+                        }
+                        if (game.isGameFinished())
+                            break;
+                        MoveList moves = game.getPossibleMoves(game.getCurrentColor());
+                        Move move = moves[random() % moves.size()];
+                        game.makeMove(move);
+                        reference.makeMove(move);
+                    }
+                }
+            });
+        for (std::thread& worker : workers)
+            worker.join();
+        positions = checkedPositions;
+        return errors;
+    }
+
+private:
+    static const uint64_t MAX_REPORTED_ERRORS = 10;
+
+    static std::string getMoves(const Game& game) {
+        std::string text;
+        for (Move move : game.getMoves())
+            text += moveToString(move);
+        return text.empty() ? "none" : text;
+    }
+
+    static std::string describeBoard(const Game& game, const ReferenceGame& reference) {
+        for (size_t x = 0; x < Board::X_DIM; x++)
+            for (size_t y = 0; y < Board::Y_DIM; y++)
+                if (game.getBoard()[Position(x, y)] != reference.get(x, y))
+                    return "boards differ at " + moveToString(Move(Position(x, y), false));
+        return "";
+    }
+
+    // Returns description of the first difference or an empty string
+    static std::string checkPosition(Game& game, const ReferenceGame& reference) {
+        std::string boardError = describeBoard(game, reference);
+        if (!boardError.empty())
+            return boardError;
+        if (game.isGameFinished() != reference.isGameFinished())
+            return "game end differs";
+        if (game.isGameFinished())
+            return "";
+        if (game.getCurrentColor() != reference.getCurrentColor())
+            return "player to move differs";
+        for (Color color : {BLACK, WHITE})
+            if (game.getScore(color) != reference.getScore(color))
+                return "scores differ";
+
+        MoveList moves = game.getPossibleMoves(game.getCurrentColor());
+        std::vector<Move> referenceMoves = reference.getPossibleMoves();
+        if (moves.size() != referenceMoves.size() || !std::equal(moves.begin(), moves.end(), referenceMoves.begin()))
+            return "legal moves differ";
+
+        Board board = game.getBoard();
+        uint64_t hash = board.hash();
+        for (Move move : moves) {
+            ReferenceGame child = reference;
+            child.makeMove(move);
+            if (!game.isMovePossible(move, game.getCurrentColor()) || !game.makeMove(move))
+                return "legal move " + moveToString(move) + " is rejected";
+            std::string childError = describeBoard(game, child);
+            game.cancelMove();
+            if (!childError.empty())
+                return "after " + moveToString(move) + ": " + childError;
+            if (!(game.getBoard() == board) || game.getBoard().hash() != hash)
+                return "cancelling " + moveToString(move) + " does not restore the board";
+        }
+
+        // every other move must be rejected without changing anything
+        std::vector<Move> illegalMoves;
+        if (!moves[0].isPass)
+            illegalMoves.push_back(Move());
+        for (size_t x = 0; x < Board::X_DIM; x++)
+            for (size_t y = 0; y < Board::Y_DIM; y++) {
+                Move move(Position(x, y), false);
+                if (std::find(moves.begin(), moves.end(), move) == moves.end())
+                    illegalMoves.push_back(move);
+            }
+        size_t moveNumber = game.getMoveNumber();
+        for (Move move : illegalMoves)
+            if (game.isMovePossible(move, game.getCurrentColor()) || game.makeMove(move) ||
+                game.getMoveNumber() != moveNumber || !(game.getBoard() == board))
+                return "illegal move " + moveToString(move) + " is accepted";
+        return "";
+    }
+};
@@ -4,8 +4,20 @@
 #include <memory>
 #include <cstdlib>
 #include <fstream>
+#include <thread>
+#include <chrono>
 
+#include "Analyzer.h"
+#include "AsyncInput.h"
+#include "EndgameCache.h"
+#include "GameRecord.h"
+#include "OpeningBook.h"
+#include "OpeningEnumerator.h"
 #include "Runner.h"
+#include "SearchTrace.h"
+#include "Tournament.h"
+#include "Trainer.h"
+#include "Verifier.h"
 #include "Game.h"
 #include "Strategy.h"
 #include "MyStrategy.h"
@@ -13,11 +25,42 @@
 
 using namespace std;
 
+#ifdef OTHELLO_COUNT_ALLOCATIONS
+// Global allocation functions are replaced to count allocations of every thread (see AllocationCounter.h)
+void* operator new(size_t size) {
+    allocationCount()++;
+    if (void* pointer = malloc(size == 0 ? 1 : size))
+        return pointer;
+    throw bad_alloc();
+}
+
+// not inlined, so that the compiler does not see free() of memory returned by operator new
+__attribute__((noinline)) void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete[](void* pointer) noexcept {
+    operator delete(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+#endif
+
 void printBoard(const Board& board) {
 	cout << ' ';
-	for (size_t i = 0; i < Board::X_DIM; i++)
+	for (size_t i = 0; i < Board::Y_DIM; i++)
 		cout << char(i + 'a');
-	cout << endl;
+	cout << '\n';
 
 	for (size_t i = 0; i < Board::X_DIM; i++) {
 		cout << i + 1;
@@ -33,14 +76,14 @@ void printBoard(const Board& board) {
 				cout << '.';
 				break;
 			};
-		cout << i + 1 << endl;
+		cout << i + 1 << '\n';
 	}
 	cout << ' ';
-	for (size_t i = 0; i < Board::X_DIM; i++)
+	for (size_t i = 0; i < Board::Y_DIM; i++)
 		cout << char(i + 'a');
-	cout << endl;
+	cout << '\n';
 
-	cout << endl;
+	cout << '\n';
 }
 
 MyConstants findConstants(double timeForMove) {
@@ -62,16 +105,12 @@ MyConstants findConstants(double timeForMove) {
 
 		int score = 0;
 
-		Strategy* black = new MyStrategy(newConstants);
-		Strategy* white = new MyStrategy(bestConstants);
-		Runner run1(black, white);
+		Runner run1(make_unique<MyStrategy>(newConstants), make_unique<MyStrategy>(bestConstants));
 		run1.run();
 		score += run1.getGame().getScoreDifference(BLACK);
 		cout << run1.getGame().getScoreDifference(BLACK) << ' ';
 
-		black = new MyStrategy(bestConstants);
-		white = new MyStrategy(newConstants);
-		Runner run2(black, white);
+		Runner run2(make_unique<MyStrategy>(bestConstants), make_unique<MyStrategy>(newConstants));
 		run2.run();
 		score += run2.getGame().getScoreDifference(WHITE);
 		cout << run2.getGame().getScoreDifference(WHITE) << ' ';
@@ -91,27 +130,552 @@ MyConstants findConstants(double timeForMove) {
 	return bestConstants;
 }
 
-void playWithServer() {
-    string s;
-    cin >> s >> s;
-    Strategy* white;
-    Strategy* black;
-    if (s == "white") {
-        white = new MyStrategy(MyConstants(10, -5, -2, 2.9));
-        black = new ServerStrategy(cin, cout);
+// othello server [--book FILE] [--weights FILE] [--time MS] [--game-time MS] [--increment MS]
+//                [--hash N] [--hash-threads N] [--large-pages]
+// Input is read in its own thread, so the server can stop the search ("stop") or limit it by
+// the time left on the clock ("time MS") while the engine thinks.
+// With --game-time the time of the whole game is split between moves, otherwise every move takes --time.
+int playWithServer(int argc, const char* argv[]) {
+    double time = 2.9;
+    double gameTime = 0;
+    double increment = 0;
+    shared_ptr<const OpeningBook> book;
+    shared_ptr<const EvaluationWeights> weights;
+    size_t hashSizeLog = 18;
+    size_t hashThreads = 1;
+    bool largePages = false;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--hash" && hasValue)
+            hashSizeLog = stoi(argv[++i]);
+        else if (arg == "--hash-threads" && hasValue)
+            hashThreads = stoi(argv[++i]);
+        else if (arg == "--large-pages")
+            largePages = true;
+        else if (arg == "--time" && hasValue)
+            time = stoi(argv[++i]) / 1000.0;
+        else if (arg == "--game-time" && hasValue)
+            gameTime = stoi(argv[++i]) / 1000.0;
+        else if (arg == "--increment" && hasValue)
+            increment = stoi(argv[++i]) / 1000.0;
+        else if (arg == "--weights" && hasValue) {
+            weights = EvaluationWeights::load(argv[++i]);
+            if (!weights) {
+                cerr << "can't load weights from " << argv[i] << endl;
+                return 1;
+            }
+        } else if (arg == "--book" && hasValue) {
+            book = OpeningBook::load(argv[++i]);
+            if (!book) {
+                cerr << "can't load opening book from " << argv[i] << endl;
+                return 1;
+            }
+        } else {
+            cerr << "bad argument " << arg << endl;
+            return 1;
+        }
+    }
+
+    AsyncInput input(cin);
+    ProtocolMessage message;
+    if (!input.read(message))
+        return 0;
+    string color = message.arguments.empty() ? message.command : message.arguments[0];
+
+    MyConstants constants(10, -5, -2, time, 0, 0, weights);
+    constants.OPENING_BOOK = book;
+    constants.TRANSPOSITION_TABLE_SIZE_LOG = hashSizeLog;
+    constants.TRANSPOSITION_TABLE_THREADS = hashThreads;
+    constants.LARGE_PAGES = largePages;
+    unique_ptr<MyStrategy> engine;
+    try {
+        engine = make_unique<MyStrategy>(constants);
+    } catch (const bad_alloc&) {
+        cerr << "can't allocate transposition table of 2^" << TranspositionTable::clampSizeLog(hashSizeLog) <<
+                " entries" << endl;
+        return 1;
+    }
+    if (largePages && engine->getTranspositionTablePageKind() == NORMAL_PAGES)
+        cerr << "huge pages are not available, transposition table uses normal pages" << endl;
+    engine->setSearchControl(&input.getControl());
+    if (gameTime > 0)
+        engine->setTimeManager(TimeManager(gameTime, increment));
+    unique_ptr<Strategy> white;
+    unique_ptr<Strategy> black;
+    if (color == "white") {
+        white = move(engine);
+        black = make_unique<ServerStrategy>(input, cout);
     }
     else {
-        black = new MyStrategy(MyConstants(10, -5, -2, 2.9));
-        white = new ServerStrategy(cin, cout);
+        black = move(engine);
+        white = make_unique<ServerStrategy>(input, cout);
+    }
+
+	Runner runner(move(black), move(white));
+	try {
+	    runner.run();
+	} catch (const runtime_error& error) {
+	    cerr << error.what() << endl;
+	}
+	cout.flush();
+	return 0;
+}
+
+// Converts text games (one game per line, e.g. "f5d6c3 d3 c4") to binary game records.
+int packGames(istream& in, ostream& out) {
+    GameRecordWriter writer(out);
+    string line;
+    size_t lineNumber = 0;
+    while (getline(in, line)) {
+        lineNumber++;
+        Game game;
+        size_t offset = 0;
+        bool isCorrect = true;
+        while (isCorrect) {
+            while (offset < line.size() && isspace(line[offset]))
+                offset++;
+            if (offset == line.size())
+                break;
+            Move move;
+            isCorrect = parseMove(line, offset, move) && !game.isGameFinished() &&
+                        game.isMovePossible(move, game.getCurrentColor());
+            if (isCorrect)
+                game.makeMove(move);
+        }
+        if (!isCorrect) {
+            cerr << "line " << lineNumber << ": illegal move at position " << offset << endl;
+            continue;
+        }
+        writer.write(game);
+    }
+    return 0;
+}
+
+// Converts binary game records back to text games.
+int unpackGames(istream& in, ostream& out) {
+    GameRecordReader reader(in);
+    vector<Move> moves;
+    int result;
+    while (reader.read(moves, result)) {
+        for (Move move : moves)
+            out << moveToString(move);
+        if (result != GameRecord::UNFINISHED)
+            out << ' ' << result;
+        out << '\n';
+    }
+    if (reader.isCorrupted()) {
+        cerr << "corrupted record" << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// othello analyze [--time MS] [--depth N] [--nodes N] [--threads N] [--weights FILE] [--multipv N]
+//                 [--cache FILE] [--cache-readonly] [--cache-empties N] [--trace FILE] [--trace-limit N]
+//                 [--book FILE] [--hash N] [--large-pages] [FILE]
+// Searches every position of recorded games.
+int analyzeGames(int argc, const char* argv[]) {
+    double time = 1.0;
+    bool isTimeSet = false;
+    int depth = 0;
+    uint64_t nodes = 0;
+    size_t threads = thread::hardware_concurrency();
+    string fileName = "-";
+    shared_ptr<const EvaluationWeights> weights;
+    size_t multiPV = 0;
+    string cacheFileName;
+    bool isCacheReadOnly = false;
+    size_t cacheEmpties = 14;
+    string traceFileName;
+    uint64_t traceLimit = 0;
+    shared_ptr<const OpeningBook> book;
+    size_t hashSizeLog = 18;
+    bool largePages = false;
+
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--time" && hasValue) {
+            time = stoi(argv[++i]) / 1000.0;
+            isTimeSet = true;
+        } else if (arg == "--depth" && hasValue)
+            depth = stoi(argv[++i]);
+        else if (arg == "--nodes" && hasValue)
+            nodes = stoull(argv[++i]);
+        else if (arg == "--threads" && hasValue)
+            threads = stoi(argv[++i]);
+        else if (arg == "--multipv" && hasValue)
+            multiPV = stoi(argv[++i]);
+        else if (arg == "--weights" && hasValue) {
+            weights = EvaluationWeights::load(argv[++i]);
+            if (!weights) {
+                cerr << "can't load weights from " << argv[i] << endl;
+                return 1;
+            }
+        } else if (arg == "--cache" && hasValue)
+            cacheFileName = argv[++i];
+        else if (arg == "--cache-readonly")
+            isCacheReadOnly = true;
+        else if (arg == "--cache-empties" && hasValue)
+            cacheEmpties = stoi(argv[++i]);
+        else if (arg == "--trace" && hasValue)
+            traceFileName = argv[++i];
+        else if (arg == "--trace-limit" && hasValue)
+            traceLimit = stoull(argv[++i]);
+        else if (arg == "--hash" && hasValue)
+            hashSizeLog = stoi(argv[++i]);
+        else if (arg == "--large-pages")
+            largePages = true;
+        else if (arg == "--book" && hasValue) {
+            book = OpeningBook::load(argv[++i]);
+            if (!book) {
+                cerr << "can't load opening book from " << argv[i] << endl;
+                return 1;
+            }
+        } else if (arg.compare(0, 2, "--") == 0) {
+            // unknown option or a known one without its value
+            cerr << "bad argument " << arg << '\n' <<
+                    "usage: othello analyze [--time MS] [--depth N] [--nodes N] [--threads N] [--weights FILE]\n"
+                    "                       [--multipv N] [--cache FILE] [--cache-readonly] [--cache-empties N]\n"
+                    "                       [--trace FILE] [--trace-limit N] [--book FILE] [--hash N] [--large-pages]\n"
+                    "                       [FILE]" << endl;
+            return 1;
+        } else
+            fileName = arg;
+    }
+    // a read-only cache is shared with other processes, but positions proved here are not added
+    shared_ptr<EndgameCache> cache;
+    if (!cacheFileName.empty()) {
+        cache = EndgameCache::open(cacheFileName, isCacheReadOnly);
+        if (!cache) {
+            cerr << "can't open endgame cache " << cacheFileName << endl;
+            return 1;
+        }
+    }
+    // explicit depth or node limit without explicit time makes analysis deterministic
+    if (!isTimeSet && (depth != 0 || nodes != 0))
+        time = 0;
+
+    MyConstants constants(10, -5, -2, time, depth, nodes, weights);
+    constants.ENDGAME_CACHE = cache;
+    constants.ENDGAME_CACHE_EMPTIES = cacheEmpties;
+    constants.OPENING_BOOK = book;
+    // every worker owns its table and touches it first, so the table is local to the worker's NUMA node
+    constants.TRANSPOSITION_TABLE_SIZE_LOG = hashSizeLog;
+    constants.LARGE_PAGES = largePages;
+    if (!traceFileName.empty()) {
+        constants.TRACE = TraceFile::create(traceFileName, traceLimit);
+        if (!constants.TRACE) {
+            cerr << "can't create " << traceFileName << endl;
+            return 1;
+        }
+    }
+    BatchAnalyzer analyzer(constants, threads, multiPV);
+    if (fileName == "-") {
+        analyzer.run(cin, cout, cerr);
+    } else {
+        ifstream in(fileName, ios::binary);
+        if (!in) {
+            cerr << "can't open " << fileName << endl;
+            return 1;
+        }
+        analyzer.run(in, cout, cerr);
+    }
+    return 0;
+}
+
+// othello book [--plies N] [--depth N] [--threads N] [--memory MB] [--temp DIR] [--output FILE]
+// Searches all positions of the first plies and writes them to an opening book.
+int buildOpeningBook(int argc, const char* argv[]) {
+    size_t plies = 8;
+    int depth = 8;
+    size_t threads = thread::hardware_concurrency();
+    size_t memory = 1024;
+    string temp = ".";
+    string output = "book.bin";
+
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--plies" && hasValue)
+            plies = stoi(argv[++i]);
+        else if (arg == "--depth" && hasValue)
+            depth = stoi(argv[++i]);
+        else if (arg == "--threads" && hasValue)
+            threads = stoi(argv[++i]);
+        else if (arg == "--memory" && hasValue)
+            memory = stoi(argv[++i]);
+        else if (arg == "--temp" && hasValue)
+            temp = argv[++i];
+        else if (arg == "--output" && hasValue)
+            output = argv[++i];
+        else {
+            cerr << "bad argument " << arg << endl;
+            return 1;
+        }
+    }
+    if (plies > OpeningEnumerator::MAX_PLIES) {
+        cerr << "at most " << OpeningEnumerator::MAX_PLIES << " plies" << endl;
+        return 1;
     }
 
-	Runner runner(black, white);
-	runner.run();
+    OpeningEnumerator enumerator(MyConstants(10, -5, -2, 0, depth), plies, threads, memory << 20, temp);
+    uint64_t positions;
+    if (!enumerator.build(output, cerr, positions)) {
+        cerr << "can't write " << output << " or temporary files to " << temp << endl;
+        return 1;
+    }
+    cerr << positions << " positions" << endl;
+    return 0;
+}
+
+// othello perft [DEPTH]
+// Counts positions after every number of plies up to DEPTH with Game and with ReferenceGame.
+int runPerft(int argc, const char* argv[]) {
+    int maxDepth = argc > 2 ? stoi(argv[2]) : 8;
+    bool isCorrect = true;
+    for (int depth = 1; depth <= maxDepth; depth++) {
+        Game game;
+        game.reserveHistory();
+        auto startTime = chrono::steady_clock::now();
+        uint64_t count = Verifier::perft(game, depth);
+        double time = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        uint64_t referenceCount = Verifier::perft(ReferenceGame(), depth);
+        uint64_t knownCount = Verifier::getKnownPerft(depth);
+
+        cout << depth << ' ' << count << ' ' << time << 's';
+        if (count != referenceCount) {
+            cout << " reference " << referenceCount;
+            isCorrect = false;
+        }
+        if (knownCount != 0 && count != knownCount) {
+            cout << " expected " << knownCount;
+            isCorrect = false;
+        }
+        cout << endl;
+    }
+    return isCorrect ? 0 : 1;
+}
+
+// othello verify [--games N] [--seed N] [--threads N]
+// Plays random games and checks Game against ReferenceGame in every position.
+int verifyGame(int argc, const char* argv[]) {
+    size_t games = 10000;
+    uint64_t seed = 0;
+    size_t threads = thread::hardware_concurrency();
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--games" && hasValue)
+            games = stoi(argv[++i]);
+        else if (arg == "--seed" && hasValue)
+            seed = stoull(argv[++i]);
+        else if (arg == "--threads" && hasValue)
+            threads = stoi(argv[++i]);
+        else {
+            cerr << "bad argument " << arg << endl;
+            return 1;
+        }
+    }
+
+    uint64_t positions;
+    uint64_t errors = Verifier::fuzz(games, seed, threads, cerr, positions);
+    cout << games << " games, " << positions << " positions, " << errors << " errors" << endl;
+    return errors == 0 ? 0 : 1;
+}
+
+// othello trace-summary FILE
+// Prints statistics of a search trace written by "othello analyze --trace FILE".
+int summarizeTrace(int argc, const char* argv[]) {
+    if (argc != 3) {
+        cerr << "usage: othello trace-summary FILE" << endl;
+        return 1;
+    }
+    vector<TraceRecord> records;
+    if (!TraceFile::read(argv[2], records)) {
+        cerr << "can't read trace " << argv[2] << endl;
+        return 1;
+    }
+    printTraceSummary(records, cout);
+    return 0;
+}
+
+// othello cache-index FILE
+// Builds the index of the endgame cache, so that all cached positions are shared through memory mapping.
+int indexEndgameCache(int argc, const char* argv[]) {
+    if (argc != 3) {
+        cerr << "usage: othello cache-index FILE" << endl;
+        return 1;
+    }
+    size_t positions;
+    if (!EndgameCache::buildIndex(argv[2], positions)) {
+        cerr << "can't index endgame cache " << argv[2] << endl;
+        return 1;
+    }
+    cout << positions << " positions" << endl;
+    return 0;
+}
+
+// othello bench [DEPTH]
+// Plays a deterministic self-play game with fixed depth search and reports node count and speed.
+int runBenchmark(int argc, const char* argv[]) {
+    int depth = argc > 2 ? stoi(argv[2]) : 6;
+
+    MyStrategy strategy(MyConstants(10, -5, -2, 0, depth));
+    Game game;
+    uint64_t nodes = 0;
+    double time = 0;
+    while (!game.isGameFinished()) {
+        SearchResult result = strategy.search(game);
+        nodes += strategy.getSearchInfo().nodes;
+        time += strategy.getSearchInfo().time;
+        game.makeMove(result.move);
+    }
+
+    cout << "moves: " << game.getMoveNumber() << endl;
+    cout << "result: " << game.getScore(BLACK) << '-' << game.getScore(WHITE) << endl;
+    cout << "nodes: " << nodes << endl;
+    cout << "time: " << time << endl;
+    cout << "nps: " << uint64_t(nodes / max(time, 1e-9)) << endl;
+#ifdef OTHELLO_COUNT_ALLOCATIONS
+    cout << "allocations: " << allocationCount() << endl;
+#endif
+    return 0;
+}
+
+// othello match [--gauntlet] [--plies N] [--balance N] [--openings N] [--threads N] [--records FILE] ENGINE...
+// ENGINE is "name=cornerCost,XFieldCost,CFieldCost,timeInMilliseconds[,maxDepth[,maxNodes]]".
+int playMatch(int argc, const char* argv[]) {
+    Tournament::Schedule schedule = Tournament::ROUND_ROBIN;
+    size_t plies = 4;
+    int balance = 5;
+    size_t openingCount = 0;
+    size_t threads = thread::hardware_concurrency();
+    string recordsFileName;
+    vector<EngineConfig> engines;
+
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--gauntlet")
+            schedule = Tournament::GAUNTLET;
+        else if (arg == "--plies" && hasValue)
+            plies = stoi(argv[++i]);
+        else if (arg == "--balance" && hasValue)
+            balance = stoi(argv[++i]);
+        else if (arg == "--openings" && hasValue)
+            openingCount = stoi(argv[++i]);
+        else if (arg == "--threads" && hasValue)
+            threads = stoi(argv[++i]);
+        else if (arg == "--records" && hasValue)
+            recordsFileName = argv[++i];
+        else if (!EngineConfig::parse(arg, engines)) {
+            cerr << "bad argument " << arg << endl;
+            return 1;
+        }
+    }
+    if (engines.size() < 2) {
+        cerr << "at least two engines are required" << endl;
+        return 1;
+    }
+
+    vector<Game> openings = Tournament::generateOpenings(plies, balance);
+    if (openingCount != 0 && openingCount < openings.size()) {
+        // take evenly spaced openings to keep the set diverse
+        vector<Game> selected;
+        for (size_t i = 0; i < openingCount; i++)
+            selected.push_back(openings[i * openings.size() / openingCount]);
+        openings.swap(selected);
+    }
+    cerr << openings.size() << " openings" << endl;
+
+    ofstream records;
+    if (!recordsFileName.empty()) {
+        records.open(recordsFileName);
+        if (!records) {
+            cerr << "can't open " << recordsFileName << endl;
+            return 1;
+        }
+    }
+
+    Tournament tournament(engines, schedule, openings, threads);
+    tournament.run(recordsFileName.empty() ? nullptr : &records, cerr);
+    tournament.printResults(cout);
+    return 0;
+}
+
+// othello train [--games N] [--depth N] [--exact N] [--random N] [--threads N] [--output FILE]
+// Fits evaluation weights to self-play games.
+int trainWeights(int argc, const char* argv[]) {
+    size_t games = 1000;
+    int depth = 3;
+    size_t exactEmpties = 10;
+    size_t randomPlies = 8;
+    size_t threads = thread::hardware_concurrency();
+    string output = "weights.txt";
+
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--games" && hasValue)
+            games = stoi(argv[++i]);
+        else if (arg == "--depth" && hasValue)
+            depth = stoi(argv[++i]);
+        else if (arg == "--exact" && hasValue)
+            exactEmpties = stoi(argv[++i]);
+        else if (arg == "--random" && hasValue)
+            randomPlies = stoi(argv[++i]);
+        else if (arg == "--threads" && hasValue)
+            threads = stoi(argv[++i]);
+        else if (arg == "--output" && hasValue)
+            output = argv[++i];
+        else {
+            cerr << "bad argument " << arg << endl;
+            return 1;
+        }
+    }
+
+    Trainer trainer(MyConstants(10, -5, -2, 0, depth), exactEmpties, randomPlies, threads);
+    trainer.generate(games, cerr);
+    cerr << trainer.getSampleCount() << " positions" << endl;
+
+    EvaluationWeights weights = trainer.fit(0.001, cerr);
+    if (!weights.save(output)) {
+        cerr << "can't write " << output << endl;
+        return 1;
+    }
+    return 0;
 }
 
 int main(int argc, const char* argv[]) {
 	srand(0);
 
+	if (argc > 1 && string(argv[1]) == "analyze")
+	    return analyzeGames(argc, argv);
+	if (argc > 1 && string(argv[1]) == "bench")
+	    return runBenchmark(argc, argv);
+	if (argc > 1 && string(argv[1]) == "match")
+	    return playMatch(argc, argv);
+	if (argc > 1 && string(argv[1]) == "train")
+	    return trainWeights(argc, argv);
+	if (argc > 1 && string(argv[1]) == "server")
+	    return playWithServer(argc, argv);
+	if (argc > 1 && string(argv[1]) == "book")
+	    return buildOpeningBook(argc, argv);
+	if (argc > 1 && string(argv[1]) == "perft")
+	    return runPerft(argc, argv);
+	if (argc > 1 && string(argv[1]) == "verify")
+	    return verifyGame(argc, argv);
+	if (argc > 1 && string(argv[1]) == "trace-summary")
+	    return summarizeTrace(argc, argv);
+	if (argc > 1 && string(argv[1]) == "cache-index")
+	    return indexEndgameCache(argc, argv);
+	if (argc > 1 && string(argv[1]) == "pack")
+	    return packGames(cin, cout);
+	if (argc > 1 && string(argv[1]) == "unpack")
+	    return unpackGames(cin, cout);
+
 	string color = "black";
 	if (argc > 1)
 	    color = argv[1];
@@ -120,22 +684,39 @@ int main(int argc, const char* argv[]) {
 	if (argc > 2)
 	    time = stoi(argv[2]) / 1000.0;
 
-    Strategy* black;
-    Strategy* white;
+	shared_ptr<const EvaluationWeights> weights;
+	if (argc > 3) {
+	    weights = EvaluationWeights::load(argv[3]);
+	    if (!weights) {
+	        cerr << "can't load weights from " << argv[3] << endl;
+	        return 1;
+	    }
+	}
+
+    AsyncInput input(cin);
+    unique_ptr<MyStrategy> engine = make_unique<MyStrategy>(MyConstants(10, -5, -2, time, 0, 0, weights));
+    engine->setSearchControl(&input.getControl());
+    unique_ptr<Strategy> black;
+    unique_ptr<Strategy> white;
 
     if (color == "black") {
-        black = new StreamStrategy(cin, cout);
-        white = new MyStrategy(MyConstants(10, -5, -2, time));
+        black = make_unique<StreamStrategy>(input, cout);
+        white = move(engine);
     } else {
-        black = new MyStrategy(MyConstants(10, -5, -2, time));
-        white = new StreamStrategy(cin, cout);
+        black = move(engine);
+        white = make_unique<StreamStrategy>(input, cout);
     }
 
-	Runner runner(black, white);
+	Runner runner(move(black), move(white));
 
     printBoard(runner.getGame().getBoard());
 	while (!runner.getGame().isGameFinished()) {
-		runner.makeMove();
+	    try {
+		    runner.makeMove();
+	    } catch (const runtime_error& error) {
+	        cerr << error.what() << endl;
+	        return 1;
+	    }
 
 		printBoard(runner.getGame().getBoard());
 	}
@@ -0,0 +1,166 @@
+#include "othello_engine.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "Game.h"
+#include "MyStrategy.h"
+
+
+struct othello_engine {
+    explicit othello_engine(std::shared_ptr<const EvaluationWeights> weights) :
+        strategy(MyConstants(10, -5, -2, 1.0, 0, 0, weights)) {}
+
+    Game game;
+    MyStrategy strategy;
+};
+
+
+namespace {
+
+int encodeMove(Move move) {
+    return move.isPass ? OTHELLO_PASS : int(Board::getIndex(move.pos));
+}
+
+bool decodeMove(int code, Move& move) {
+    if (code == OTHELLO_PASS) {
+        move = Move();
+        return true;
+    }
+    if (code < 0 || size_t(code) >= Board::SIZE)
+        return false;
+    move = Move(Position(code / Board::Y_DIM, code % Board::Y_DIM), false);
+    return true;
+}
+
+bool play(Game& game, int code) {
+    Move move;
+    return decodeMove(code, move) && !game.isGameFinished() && game.makeMove(move);
+}
+
+void setPrincipalVariation(const std::vector<Move>& variation, othello_result& result) {
+    result.pv_length = 0;
+    for (size_t i = 0; i < variation.size() && i < OTHELLO_MAX_PV; i++)
+        result.pv[result.pv_length++] = encodeMove(variation[i]);
+}
+
+// All-zero limits are the same as no limits: one second per search
+void setLimits(MyStrategy& strategy, const othello_limits* limits) {
+    if (limits && (limits->time_ms != 0 || limits->depth != 0 || limits->nodes != 0))
+        strategy.setLimits(limits->time_ms / 1000.0, limits->depth, limits->nodes);
+    else
+        strategy.setLimits(1.0, 0, 0);
+}
+
+}
+
+
+extern "C" {
+
+int othello_board_width(void) {
+    return int(Board::Y_DIM);
+}
+
+int othello_board_height(void) {
+    return int(Board::X_DIM);
+}
+
+othello_engine* othello_engine_create(const char* weights_file) {
+    try {
+        std::shared_ptr<const EvaluationWeights> weights;
+        if (weights_file) {
+            weights = EvaluationWeights::load(weights_file);
+            if (!weights)
+                return nullptr;
+        }
+        return new othello_engine(weights);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void othello_engine_free(othello_engine* engine) {
+    delete engine;
+}
+
+int othello_engine_set_position(othello_engine* engine, const int* moves, size_t count) {
+    try {
+        Game game;
+        for (size_t i = 0; i < count; i++)
+            if (!play(game, moves[i]))
+                return -1;
+        engine->game = game;
+    } catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+int othello_engine_play(othello_engine* engine, int move) {
+    try {
+        return play(engine->game, move) ? 0 : -1;
+    } catch (...) {
+        return -1;
+    }
+}
+
+int othello_engine_side_to_move(const othello_engine* engine) {
+    if (engine->game.isGameFinished())
+        return -1;
+    return engine->game.getCurrentColor() == BLACK ? 0 : 1;
+}
+
+int othello_engine_legal_moves(const othello_engine* engine, int* moves, size_t capacity) {
+    if (engine->game.isGameFinished())
+        return 0;
+    MoveList legalMoves = engine->game.getPossibleMoves(engine->game.getCurrentColor());
+    for (size_t i = 0; i < legalMoves.size() && i < capacity; i++)
+        moves[i] = encodeMove(legalMoves[i]);
+    return int(legalMoves.size());
+}
+
+int othello_engine_search(othello_engine* engine, const othello_limits* limits, othello_result* result) {
+    if (engine->game.isGameFinished())
+        return -1;
+    try {
+        setLimits(engine->strategy, limits);
+        SearchResult searchResult = engine->strategy.search(engine->game);
+        const SearchInfo& info = engine->strategy.getSearchInfo();
+        result->move = encodeMove(searchResult.move);
+        result->score = searchResult.score;
+        result->is_exact = 1;
+        result->is_finished = searchResult.isFinished;
+        result->depth = info.depth;
+        result->nodes = info.nodes;
+        setPrincipalVariation(engine->strategy.getPrincipalVariation(engine->game, searchResult.move,
+                                                                     std::max(info.depth, 1)), *result);
+    } catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+int othello_engine_analyze(othello_engine* engine, const othello_limits* limits, size_t multi_pv,
+                           othello_result* results, size_t capacity) {
+    if (engine->game.isGameFinished())
+        return 0;
+    try {
+        setLimits(engine->strategy, limits);
+        std::vector<MoveAnalysis> analysis = engine->strategy.analyze(engine->game, multi_pv);
+        for (size_t i = 0; i < analysis.size() && i < capacity; i++) {
+            results[i].move = encodeMove(analysis[i].move);
+            results[i].score = analysis[i].score;
+            results[i].is_exact = analysis[i].bound == MoveAnalysis::EXACT;
+            results[i].is_finished = analysis[i].isFinished;
+            results[i].depth = analysis[i].depth;
+            results[i].nodes = engine->strategy.getSearchInfo().nodes;
+            setPrincipalVariation(analysis[i].principalVariation, results[i]);
+        }
+        return int(analysis.size());
+    } catch (...) {
+        return -1;
+    }
+}
+
+}
@@ -0,0 +1,69 @@
+#ifndef OTHELLO_ENGINE_H
+#define OTHELLO_ENGINE_H
+
+/* C interface of the engine, implemented in the othello_engine library.
+ * Moves are encoded as x * width + y (x is the row, y is the column), OTHELLO_PASS is a pass.
+ * Functions returning int return 0 on success and a negative value on error. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTHELLO_PASS (-1)
+#define OTHELLO_MAX_PV 128
+
+typedef struct othello_engine othello_engine;
+
+/* Search stops when any of the limits is reached. Zero means no limit,
+ * but time is limited to one second if all limits are zero. */
+typedef struct {
+    int time_ms;
+    int depth;
+    uint64_t nodes;
+} othello_limits;
+
+typedef struct {
+    int move;
+    int score;       /* from the point of view of the player to move */
+    int is_exact;    /* for analysis: 1 - exact score, 0 - upper bound */
+    int is_finished; /* score is the final score difference */
+    int depth;       /* depth of the last completed iteration */
+    uint64_t nodes;
+    int pv[OTHELLO_MAX_PV]; /* principal variation, starts with move */
+    int pv_length;
+} othello_result;
+
+/* Board dimensions the library was built for */
+int othello_board_width(void);
+int othello_board_height(void);
+
+/* weights_file is a file written by "othello train", or NULL for the default evaluation.
+ * Returns NULL if the weights can't be loaded or memory can't be allocated. */
+othello_engine* othello_engine_create(const char* weights_file);
+void othello_engine_free(othello_engine* engine);
+
+/* Sets the position reached from the initial one by the given moves. */
+int othello_engine_set_position(othello_engine* engine, const int* moves, size_t count);
+int othello_engine_play(othello_engine* engine, int move);
+
+/* Color to move: 0 - black, 1 - white. Returns -1 if the game is finished. */
+int othello_engine_side_to_move(const othello_engine* engine);
+
+/* Writes at most capacity legal moves, returns their total number. */
+int othello_engine_legal_moves(const othello_engine* engine, int* moves, size_t capacity);
+
+int othello_engine_search(othello_engine* engine, const othello_limits* limits, othello_result* result);
+
+/* Scores of all legal moves from the best to the worst, exact for multi_pv best moves.
+ * Writes at most capacity results, returns the number of legal moves. */
+int othello_engine_analyze(othello_engine* engine, const othello_limits* limits, size_t multi_pv,
+                           othello_result* results, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
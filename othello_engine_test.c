@@ -0,0 +1,62 @@
+/* Checks the C interface of the engine, run by ctest. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "othello_engine.h"
+
+static int failures = 0;
+
+static void check(int condition, const char* description) {
+    if (!condition) {
+        printf("FAILED: %s\n", description);
+        failures++;
+    }
+}
+
+static int isLegal(othello_engine* engine, int move) {
+    int moves[128];
+    int count = othello_engine_legal_moves(engine, moves, 128);
+    for (int i = 0; i < count; i++)
+        if (moves[i] == move)
+            return 1;
+    return 0;
+}
+
+int main(void) {
+    othello_engine* engine = othello_engine_create(NULL);
+    check(engine != NULL, "engine is created");
+    if (!engine)
+        return 1;
+
+    othello_result result;
+    othello_limits depthLimit = {0, 4, 0};
+    check(othello_engine_search(engine, &depthLimit, &result) == 0, "search with depth limit succeeds");
+    check(result.depth == 4 && result.nodes > 0 && isLegal(engine, result.move), "search with depth limit is completed");
+    check(result.pv_length >= 1 && result.pv_length <= 4 && result.pv[0] == result.move,
+          "principal variation of search starts with the best move");
+
+    othello_result results[32];
+    int moveCount = othello_engine_analyze(engine, &depthLimit, 1, results, 32);
+    check(moveCount == 4, "analysis returns every legal move");
+    for (int i = 0; i < moveCount && i < 32; i++)
+        check(results[i].pv_length >= 1 && results[i].pv_length <= 4 && results[i].pv[0] == results[i].move,
+              "principal variation of analysis starts with the analyzed move");
+
+    /* all-zero limits mean one second, as NULL does */
+    othello_limits noLimits;
+    memset(&noLimits, 0, sizeof(noLimits));
+    check(othello_engine_search(engine, &noLimits, &result) == 0, "search with zero limits succeeds");
+    check(result.depth > 0 && result.nodes > 0 && isLegal(engine, result.move), "search with zero limits searches");
+    check(othello_engine_search(engine, NULL, &result) == 0, "search without limits succeeds");
+    check(result.depth > 0 && result.nodes > 0 && isLegal(engine, result.move), "search without limits searches");
+
+    check(othello_engine_play(engine, 64) != 0, "move outside of the board is rejected");
+    check(othello_engine_play(engine, OTHELLO_PASS) != 0, "pass is rejected when there are moves");
+    check(othello_engine_side_to_move(engine) == 0, "black moves first");
+
+    othello_engine_free(engine);
+    if (failures == 0)
+        printf("passed\n");
+    return failures == 0 ? 0 : 1;
+}